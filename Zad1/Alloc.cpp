@@ -4,6 +4,9 @@
 
 #include "Alloc.h"
 
+#include <fstream>
+#include <unistd.h>
+
 int **tableAlloc(int size)
 {
 	int **result;
@@ -18,4 +21,26 @@ void clearTable(int **table, int size)
 	for (int i = 0; i < size; i++)
 		for (int j = 0; j < size; j++)
 			table[i][j] = 0;
+}
+
+void copyTable(int **from, int **to, int size)
+{
+	for (int i = 0; i < size; i++)
+		for (int j = 0; j < size; j++)
+			to[i][j] = from[i][j];
+}
+
+void tableFree(int **table, int size)
+{
+	for (int i = 0; i < size; i++)
+		delete[] table[i];
+	delete[] table;
+}
+
+long long residentBytes()
+{
+	std::ifstream statm("/proc/self/statm");
+	long long pages = 0, resident = 0;
+	statm >> pages >> resident;
+	return resident * sysconf(_SC_PAGESIZE);
 }
\ No newline at end of file
@@ -8,5 +8,9 @@
 
 int **tableAlloc( int size );
 void clearTable( int** table, int size );
+void copyTable( int **from, int **to, int size );
+void tableFree( int **table, int size );
+// resident set of this process in bytes, 0 where /proc is not available
+long long residentBytes();
 
 #endif /* ALLOC_H_ */
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+ * Args.cpp
+ */
+
+#include "Args.h"
+
+#include <cstdlib>
+#include <cstring>
+
+const char *stringArg(int argc, char **argv, const char *name, const char *defaultValue)
+{
+    for (int i = 1; i + 1 < argc; i++)
+        if (!strcmp(argv[i], name))
+            return argv[i + 1];
+    return defaultValue;
+}
+
+int intArg(int argc, char **argv, const char *name, int defaultValue)
+{
+    const char *value = stringArg(argc, argv, name, 0);
+    return value ? atoi(value) : defaultValue;
+}
+
+double doubleArg(int argc, char **argv, const char *name, double defaultValue)
+{
+    const char *value = stringArg(argc, argv, name, 0);
+    return value ? atof(value) : defaultValue;
+}
+
+bool flagArg(int argc, char **argv, const char *name)
+{
+    for (int i = 1; i < argc; i++)
+        if (!strcmp(argv[i], name))
+            return true;
+    return false;
+}
+
+std::vector<std::string> listArg(int argc, char **argv, const char *name, const char *defaultValue)
+{
+    std::vector<std::string> items;
+    std::string value = stringArg(argc, argv, name, defaultValue);
+    size_t start = 0;
+    while (start <= value.size())
+    {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos)
+            end = value.size();
+        if (end > start)
+            items.push_back(value.substr(start, end - start));
+        start = end + 1;
+    }
+    return items;
+}
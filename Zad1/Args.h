@@ -0,0 +1,19 @@
+/*
+ * Args.h
+ */
+
+#ifndef ARGS_H_
+#define ARGS_H_
+
+#include <string>
+#include <vector>
+
+// "-name value" command line options shared by the drivers
+int intArg(int argc, char **argv, const char *name, int defaultValue);
+double doubleArg(int argc, char **argv, const char *name, double defaultValue);
+const char *stringArg(int argc, char **argv, const char *name, const char *defaultValue);
+bool flagArg(int argc, char **argv, const char *name);
+// comma separated list, e.g. "-sizes 512,1024"
+std::vector<std::string> listArg(int argc, char **argv, const char *name, const char *defaultValue);
+
+#endif /* ARGS_H_ */
@@ -0,0 +1,242 @@
+/*
+ * Benchmark.cpp
+ *
+ * Throughput and scaling benchmark for the Life engines:
+ *   mpirun -np 8 ./benchmark -sizes 1024,4096 -steps 50 -densities 0.3 \
+ *          -engines sequential,parallel,parallel-rle (or all) -ranks 1,2,4,8 -warmup 1 -reps 5 -weak 1024
+ * Every configuration is run warmup + reps times from a fresh soup; the
+ * median of the slowest rank's wall time is reported. Rank counts are
+ * emulated with sub-communicators of the first k ranks of MPI_COMM_WORLD.
+ * The exit code is 1 if the resident set kept growing between
+ * configurations of the same board size, i.e. an engine leaked its tables.
+ */
+
+#include "Alloc.h"
+#include "Args.h"
+#include "LifeEngines.h"
+#include "LifeParallelImplementation.h"
+#include "LifeTimersReport.h"
+#include "PatternLoader.h"
+#include "SimpleRules.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <map>
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const long long RESIDENT_SLACK = 2LL << 20;
+
+struct Result
+{
+    string engine;
+    int ranks;
+    int size;
+    double density;
+    int steps;
+    double seconds;     // median over the repetitions
+    double haloLatency; // avg time of one halo exchange (pack + post + wait)
+    double haloBytes;   // avg halo bytes one process sends per step
+};
+
+double median(vector<double> values)
+{
+    sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+// collective over comm; false if the engine cannot run on comm
+bool measure(Rules *rules, const string &engine, MPI_Comm comm, int size, double density, int steps, int warmup,
+             int reps, Result &result)
+{
+    Life *life = createLifeEngine(engine, comm);
+    if (!life)
+        return false;
+    LifeTimers timers;
+    life->setRules(rules);
+    life->setSize(size);
+    life->setTimers(&timers);
+
+    vector<double> times;
+    long long haloBytes = 0;
+    LifeParallelImplementation *parallel = dynamic_cast<LifeParallelImplementation *>(life);
+    for (int rep = -warmup; rep < reps; rep++)
+    {
+        life->clear();
+        PatternLoader loader(life);
+        loader.soup(1, 1, size - 2, size - 2, density, 12345);
+        life->setDistributedInit(true);
+        life->beforeFirstStep();
+        timers.reset();
+
+        long long haloBefore = parallel ? parallel->haloBytesSent() : 0;
+        MPI_Barrier(comm);
+        double start = MPI_Wtime();
+        life->advance(steps);
+        double local = MPI_Wtime() - start, slowest;
+        MPI_Allreduce(&local, &slowest, 1, MPI_DOUBLE, MPI_MAX, comm);
+        haloBytes = parallel ? parallel->haloBytesSent() - haloBefore : 0;
+        if (rep >= 0)
+            times.push_back(slowest);
+    }
+
+    double min, post, wait, pack, max;
+    reduceTimer(timers, LifeTimers::HALO_POST, min, post, max, comm);
+    reduceTimer(timers, LifeTimers::HALO_WAIT, min, wait, max, comm);
+    reduceTimer(timers, LifeTimers::HALO_PACK, min, pack, max, comm);
+    long long totalHaloBytes;
+    MPI_Allreduce(&haloBytes, &totalHaloBytes, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    MPI_Comm_size(comm, &result.ranks);
+    result.engine = engine;
+    result.size = size;
+    result.density = density;
+    result.steps = steps;
+    result.seconds = median(times);
+    result.haloLatency = result.ranks > 1 ? (post + wait + pack) / steps : 0.0;
+    result.haloBytes = (double)totalHaloBytes / result.ranks / steps;
+    delete life;
+    return true;
+}
+
+void printResult(const Result &r)
+{
+    double cells = (double)(r.size - 2) * (r.size - 2);
+    // every step reads and writes both int tables once
+    double bytesPerStep = 4.0 * sizeof(int) * cells;
+    cout << setw(16) << r.engine << setw(6) << r.ranks << setw(8) << r.size << setw(9) << r.density << setw(7)
+         << r.steps << setw(13) << r.seconds << setw(13) << cells * r.steps / r.seconds << setw(13) << bytesPerStep
+         << setw(11) << r.haloBytes << setw(13) << r.haloLatency << endl;
+}
+
+// false if the resident set grew by more than half a board's tables since the
+// last configuration with the same board size: freed tables are reused by the
+// next engine, leaked ones pile up by 4 * size^2 ints per configuration
+bool residentFlat(map<int, long long> &residentAfter, const Result &r, int rank)
+{
+    malloc_trim(0); // freed but untrimmed heap would look like growth
+    long long resident = residentBytes();
+    // on small boards thread arenas and MPI buffers outweigh the tables
+    long long allowed = max(2LL * r.size * r.size * (long long)sizeof(int), RESIDENT_SLACK);
+    map<int, long long>::iterator last = residentAfter.find(r.size);
+    bool flat = last == residentAfter.end() || resident - last->second <= allowed;
+    if (!flat)
+        cerr << "rank " << rank << ": resident set grew by " << (resident - last->second) / (1024 * 1024)
+             << " MB after " << r.engine << " at size " << r.size << ", tables leaked?" << endl;
+    residentAfter[r.size] = resident;
+    return flat;
+}
+
+void printScaling(const char *title, const vector<Result> &results)
+{
+    if (results.empty())
+        return;
+    cout << endl << title << " (" << results[0].engine << ", base " << results[0].ranks << " rank(s))" << endl;
+    cout << " ranks    size      time[s]  speedup  efficiency" << endl;
+    const Result &base = results[0];
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        // strong: same board, ideal time shrinks with ranks; weak: same work per rank
+        double speedup = base.seconds / r.seconds;
+        double work = ((double)(r.size - 2) * (r.size - 2)) / ((double)(base.size - 2) * (base.size - 2));
+        double efficiency = speedup * work * base.ranks / r.ranks;
+        cout << setw(6) << r.ranks << setw(8) << r.size << setw(13) << r.seconds << setw(9) << speedup * work
+             << setw(12) << efficiency << endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int provided;
+    // only the thread calling the engine talks to MPI
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int worldSize, worldRank;
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+
+    vector<string> sizes = listArg(argc, argv, "-sizes", "1024");
+    vector<string> densities = listArg(argc, argv, "-densities", "0.3");
+    vector<string> engines = listArg(argc, argv, "-engines", "sequential,parallel");
+    if (engines.size() == 1 && engines[0] == "all")
+        engines = lifeEngineNames();
+    vector<string> rankCounts = listArg(argc, argv, "-ranks", "");
+    const int steps = intArg(argc, argv, "-steps", 20);
+    const int warmup = intArg(argc, argv, "-warmup", 1);
+    const int reps = intArg(argc, argv, "-reps", 5);
+    const int weakBase = intArg(argc, argv, "-weak", 0); // board side for one rank, 0 = no weak scaling
+
+    vector<int> ranks;
+    for (size_t i = 0; i < rankCounts.size(); i++)
+        if (atoi(rankCounts[i].c_str()) >= 1 && atoi(rankCounts[i].c_str()) <= worldSize)
+            ranks.push_back(atoi(rankCounts[i].c_str()));
+    if (ranks.empty())
+        for (int k = 1; k <= worldSize; k *= 2)
+            ranks.push_back(k);
+
+    Rules *rules = new SimpleRules();
+    cout << setprecision(4);
+    if (!worldRank)
+        cout << "          engine ranks    size  density  steps    median[s]      cells/s    bytes/step"
+                " halo bytes  halo lat[s]"
+             << endl;
+
+    vector<Result> results, weak;
+    map<int, long long> residentAfter; // by board size
+    int leaks = 0;
+    for (size_t k = 0; k < ranks.size(); k++)
+    {
+        MPI_Comm comm;
+        MPI_Comm_split(MPI_COMM_WORLD, worldRank < ranks[k] ? 0 : MPI_UNDEFINED, worldRank, &comm);
+        if (comm != MPI_COMM_NULL)
+        {
+            for (size_t e = 0; e < engines.size(); e++)
+                for (size_t s = 0; s < sizes.size(); s++)
+                    for (size_t d = 0; d < densities.size(); d++)
+                    {
+                        Result r;
+                        if (!measure(rules, engines[e], comm, atoi(sizes[s].c_str()), atof(densities[d].c_str()), steps,
+                                     warmup, reps, r))
+                            continue;
+                        results.push_back(r);
+                        if (!worldRank)
+                            printResult(r);
+                        leaks += !residentFlat(residentAfter, r, worldRank);
+                    }
+            if (weakBase > 0)
+            {
+                Result r;
+                int size = (int)lround(weakBase * sqrt((double)ranks[k]));
+                if (measure(rules, "parallel", comm, size, atof(densities[0].c_str()), steps, warmup, reps, r))
+                    weak.push_back(r);
+            }
+            MPI_Comm_free(&comm);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    if (!worldRank)
+    {
+        for (size_t s = 0; s < sizes.size(); s++)
+            for (size_t d = 0; d < densities.size(); d++)
+            {
+                vector<Result> strong;
+                for (size_t i = 0; i < results.size(); i++)
+                    if (results[i].engine == "parallel" && results[i].size == atoi(sizes[s].c_str()) &&
+                        results[i].density == atof(densities[d].c_str()))
+                        strong.push_back(results[i]);
+                printScaling("Strong scaling", strong);
+            }
+        printScaling("Weak scaling", weak);
+    }
+
+    MPI_Finalize();
+    return leaks ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * CycleDetector.cpp
+ */
+
+#include "CycleDetector.h"
+
+CycleDetector::CycleDetector(int historyLength)
+{
+    historyLength_ = historyLength < 2 ? 2 : historyLength;
+    history_ = new unsigned long long[historyLength_];
+    reset();
+}
+
+CycleDetector::~CycleDetector()
+{
+    delete[] history_;
+}
+
+void CycleDetector::reset()
+{
+    stored_ = 0;
+    period_ = 0;
+}
+
+unsigned long long CycleDetector::back(int generations)
+{
+    return history_[(stored_ - 1 - generations) % historyLength_];
+}
+
+int CycleDetector::push(unsigned long long hash)
+{
+    history_[stored_ % historyLength_] = hash;
+    stored_++;
+    if (period_)
+    {
+        return period_;
+    }
+    for (int p = 1; 2 * p <= historyLength_ && 2 * p <= stored_; p++)
+    {
+        int i = 0;
+        while (i < p && back(i) == back(i + p))
+        {
+            i++;
+        }
+        if (i == p)
+        {
+            period_ = p;
+            break;
+        }
+    }
+    return period_;
+}
+
+int CycleDetector::period()
+{
+    return period_;
+}
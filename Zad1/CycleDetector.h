@@ -0,0 +1,32 @@
+/*
+ * CycleDetector.h
+ */
+
+#ifndef CYCLEDETECTOR_H_
+#define CYCLEDETECTOR_H_
+
+// Keeps the last few board hashes and reports a fixed point (period 1) or a
+// period-p oscillation. A cycle is reported only once the last p hashes repeat
+// the p hashes before them, so a single 64-bit collision cannot stop a run.
+class CycleDetector
+{
+private:
+    unsigned long long *history_; // ring buffer of hashes
+    int historyLength_;
+    int stored_;                  // number of hashes pushed so far
+    int period_;                  // detected period, 0 if none yet
+
+    unsigned long long back(int generations); // hash pushed generations ago
+
+public:
+    // detects periods up to historyLength / 2
+    CycleDetector(int historyLength = 64);
+    virtual ~CycleDetector();
+
+    // returns the detected period or 0
+    int push(unsigned long long hash);
+    int period();
+    void reset();
+};
+
+#endif /* CYCLEDETECTOR_H_ */
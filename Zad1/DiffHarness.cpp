@@ -0,0 +1,219 @@
+/*
+ * DiffHarness.cpp
+ *
+ * Runs two Life engines in lockstep and compares their board digests after
+ * every step:
+ *   mpirun -np 4 ./diffharness -a sequential -b parallel -size 512 -steps 200 \
+ *          -trials 4 -density 0.3 -seed 1 [-stride 1] [-torus] [-pattern file row col ...]
+ * Every trial starts from a soup (seed + trial); -pattern / -soup arguments
+ * add one more trial. An engine that cannot be split over the processes
+ * (sequential) runs replicated on each of them. On the first mismatch the
+ * step, the first differing tile and its first differing cell are reported
+ * and the exit code is 1. With -stride n the engines advance() n generations
+ * between comparisons, which lets engines without a per-step barrier run ahead.
+ * A resident set that grows from trial to trial (engine tables leaked) is
+ * reported and also gives exit code 1.
+ */
+
+#include "Alloc.h"
+#include "Args.h"
+#include "LifeEngines.h"
+#include "PatternLoader.h"
+#include "SimpleRules.h"
+
+#include <iostream>
+#include <malloc.h>
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static const long long RESIDENT_SLACK = 2LL << 20;
+
+struct Trial
+{
+    double density;            // soup density, unused for a pattern trial
+    unsigned long long seed;
+    bool fromArgs;             // -pattern / -soup arguments instead of a soup
+};
+
+Life *createEngine(const string &name)
+{
+    Life *life = createLifeEngine(name, MPI_COMM_WORLD);
+    return life ? life : createLifeEngine(name, MPI_COMM_SELF);
+}
+
+bool initialize(Life *life, const Trial &trial, int argc, char **argv)
+{
+    PatternLoader loader(life);
+    int size = life->getSize();
+    if (trial.fromArgs)
+    {
+        if (!loader.loadArgs(argc, argv))
+            return false;
+    }
+    else
+    {
+        loader.soup(1, 1, size - 2, size - 2, trial.density, trial.seed);
+    }
+    life->setDistributedInit(true);
+    life->beforeFirstStep();
+    life->setHashing(true);
+    return true;
+}
+
+// collective; reports where the engines first differ
+void reportMismatch(Life *a, Life *b, int step, int rank)
+{
+    int tiles = a->hashTiles();
+    vector<unsigned long long> hashA(tiles * tiles), hashB(tiles * tiles);
+    a->globalTileHashes(hashA.data());
+    b->globalTileHashes(hashB.data());
+    a->afterLastStep();
+    b->afterLastStep();
+    if (rank)
+        return;
+
+    cout << "MISMATCH after step " << step << endl;
+    for (int tile = 0; tile < tiles * tiles; tile++)
+    {
+        if (hashA[tile] == hashB[tile])
+            continue;
+        int firstRow = (tile / tiles) * Life::HASH_TILE;
+        int firstCol = (tile % tiles) * Life::HASH_TILE;
+        int lastRow = min(firstRow + Life::HASH_TILE, a->getSize() - 1);
+        int lastCol = min(firstCol + Life::HASH_TILE, a->getSize() - 1);
+        cout << "first differing tile (" << tile / tiles << ", " << tile % tiles << "): rows [" << firstRow << ", "
+             << lastRow << ") cols [" << firstCol << ", " << lastCol << ")" << endl;
+        for (int row = max(firstRow, 1); row < lastRow; row++)
+            for (int col = max(firstCol, 1); col < lastCol; col++)
+                if (a->getCellState(row, col) != b->getCellState(row, col) ||
+                    a->getPollution(row, col) != b->getPollution(row, col))
+                {
+                    cout << "first differing cell (" << row << ", " << col << "): cell " << a->getCellState(row, col)
+                         << " vs " << b->getCellState(row, col) << ", pollution " << a->getPollution(row, col)
+                         << " vs " << b->getPollution(row, col) << endl;
+                    return;
+                }
+        return;
+    }
+}
+
+// collective; true if both engines agree for all steps
+bool runTrial(Rules *rules, const string &nameA, const string &nameB, int size, int steps, int stride, bool torus,
+              const Trial &trial, int argc, char **argv, int rank)
+{
+    Life *a = createEngine(nameA);
+    Life *b = createEngine(nameB);
+    Life *engines[2] = {a, b};
+    for (int i = 0; i < 2; i++)
+    {
+        engines[i]->setRules(rules);
+        if (torus)
+            engines[i]->setBoundary(Life::PERIODIC);
+        engines[i]->setSize(size);
+        if (!initialize(engines[i], trial, argc, argv))
+            MPI_Abort(MPI_COMM_WORLD, 2);
+    }
+
+    bool same = true;
+    int step = 0;
+    for (;;)
+    {
+        if (a->stateHash() != b->stateHash())
+        {
+            reportMismatch(a, b, step, rank);
+            same = false;
+            break;
+        }
+        if (step == steps)
+            break;
+        int generations = min(stride, steps - step);
+        a->advance(generations);
+        b->advance(generations);
+        step += generations;
+    }
+    delete a;
+    delete b;
+    return same;
+}
+
+int main(int argc, char **argv)
+{
+    int provided;
+    // only the thread calling the engine talks to MPI
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    const string nameA = stringArg(argc, argv, "-a", "sequential");
+    const string nameB = stringArg(argc, argv, "-b", "parallel");
+    const int size = intArg(argc, argv, "-size", 512);
+    const int steps = intArg(argc, argv, "-steps", 100);
+    const int trials = intArg(argc, argv, "-trials", 3);
+    const double density = doubleArg(argc, argv, "-density", 0.3);
+    const unsigned long long seed = intArg(argc, argv, "-seed", 1);
+    const int stride = max(1, intArg(argc, argv, "-stride", 1));
+    const bool torus = flagArg(argc, argv, "-torus");
+
+    Life *probeA = createEngine(nameA);
+    Life *probeB = createEngine(nameB);
+    if (!probeA || !probeB)
+    {
+        if (!rank)
+            cerr << "unknown engine " << (probeA ? nameB : nameA) << endl;
+        MPI_Finalize();
+        return 2;
+    }
+    delete probeA;
+    delete probeB;
+
+    vector<Trial> plan;
+    for (int i = 0; i < trials; i++)
+    {
+        Trial trial = {density, seed + i, false};
+        plan.push_back(trial);
+    }
+    if (PatternLoader::hasArgs(argc, argv))
+    {
+        Trial trial = {0.0, 0, true};
+        plan.push_back(trial);
+    }
+
+    Rules *rules = new SimpleRules();
+    int failed = 0;
+    bool leaked = false;
+    long long residentFirst = 0;
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        bool same = runTrial(rules, nameA, nameB, size, steps, stride, torus, plan[i], argc, argv, rank);
+        if (!rank)
+        {
+            cout << "trial " << i << (plan[i].fromArgs ? " (pattern)" : " (soup)") << ": "
+                 << (same ? "OK" : "FAILED") << endl;
+        }
+        failed += !same;
+
+        // both engines are freed again, later trials reuse their tables; on
+        // small boards allocator arenas of the worker threads and MPI's
+        // message buffers outweigh one set of tables
+        malloc_trim(0);
+        long long resident = residentBytes();
+        long long allowed = max(4LL * size * size * (long long)sizeof(int), RESIDENT_SLACK);
+        if (!i)
+            residentFirst = resident;
+        else if (resident - residentFirst > allowed && !leaked)
+        {
+            cerr << "rank " << rank << ": resident set grew by " << (resident - residentFirst) / (1024 * 1024)
+                 << " MB since trial 0, engine tables leaked?" << endl;
+            leaked = true;
+        }
+    }
+    if (!rank)
+        cout << nameA << " vs " << nameB << ": " << plan.size() - failed << " of " << plan.size() << " trials match over "
+             << steps << " steps" << endl;
+
+    MPI_Finalize();
+    return failed || leaked ? 1 : 0;
+}
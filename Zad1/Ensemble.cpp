@@ -0,0 +1,83 @@
+/*
+ * Ensemble.cpp
+ *
+ * Runs a sweep of independent boards in one MPI job:
+ *   mpirun -np P ./ensemble -boards 256 -size 512 -steps 1000 -density 0.3 -seed 1 [-until-steady] [-threads n]
+ * Board b starts from a soup seeded with seed + b. Every rank steps its boards
+ * on -threads threads, all hardware threads by default.
+ */
+
+#include "Args.h"
+#include "LifeEnsemble.h"
+#include "PatternLoader.h"
+#include "SimpleRules.h"
+
+#include <iostream>
+#include <mpi.h>
+
+using namespace std;
+
+struct SoupParams
+{
+    int size;
+    double density;
+    unsigned long long seed;
+};
+
+void soupInit(Life *life, int board, void *arg)
+{
+    SoupParams *params = (SoupParams *)arg;
+    PatternLoader loader(life);
+    loader.soup(1, 1, params->size - 2, params->size - 2, params->density, params->seed + board);
+}
+
+int main(int argc, char **argv)
+{
+    int provided;
+    // the pool threads of LifeEnsemble make no MPI calls
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int procs, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &procs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    const int boards = intArg(argc, argv, "-boards", 64);
+    const int steps = intArg(argc, argv, "-steps", 100);
+    const bool untilSteady = flagArg(argc, argv, "-until-steady");
+    SoupParams params;
+    params.size = intArg(argc, argv, "-size", 512);
+    params.density = doubleArg(argc, argv, "-density", 0.3);
+    params.seed = intArg(argc, argv, "-seed", 1);
+
+    Rules *rules = new SimpleRules();
+    double setupStart = MPI_Wtime();
+    LifeEnsemble ensemble(rules, params.size, boards, intArg(argc, argv, "-threads", 0));
+    ensemble.initialize(soupInit, &params);
+    double start = MPI_Wtime();
+    vector<BoardStats> stats = ensemble.run(steps, untilSteady, intArg(argc, argv, "-history", 64));
+    double end = MPI_Wtime();
+
+    if (!rank)
+    {
+        double boardSeconds = 0.0;
+        long long generations = 0;
+        cout << "board living pollution[%] steps period seconds" << endl;
+        for (int b = 0; b < boards; b++)
+        {
+            cout << b << " " << stats[b].livingCells << " " << 100.0 * stats[b].averagePollution << " "
+                 << stats[b].steps << " " << stats[b].period << " " << stats[b].seconds << endl;
+            boardSeconds += stats[b].seconds;
+            generations += stats[b].steps;
+        }
+        cout << "MPI size         : " << procs << endl;
+        cout << "Threads / rank   : " << ensemble.threads() << endl;
+        cout << "Boards           : " << boards << endl;
+        cout << "Board size       : " << params.size << endl;
+        cout << "Generations      : " << generations << endl;
+        cout << "Setup time       : " << (start - setupStart) << " sek. " << endl;
+        cout << "Ensemble time    : " << (end - start) << " sek. " << endl;
+        cout << "Overhead / board : " << ((end - start) * procs * ensemble.threads() - boardSeconds) / boards << " sek. " << endl;
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * HaloCodec.cpp
+ */
+
+#include "HaloCodec.h"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+HaloCodec::Encoding HaloCodec::fromName(const char *name)
+{
+    if (!strcmp(name, "packed"))
+        return PACKED;
+    if (!strcmp(name, "rle"))
+        return PACKED_RLE;
+    return RAW;
+}
+
+HaloCodec::HaloCodec(Encoding encoding, int size)
+{
+    encoding_ = encoding;
+    size_ = size;
+    scratch_ = new unsigned char[packedBytes()];
+}
+
+HaloCodec::~HaloCodec()
+{
+    delete[] scratch_;
+}
+
+int HaloCodec::packedBytes()
+{
+    return (size_ + 7) / 8 + size_;
+}
+
+int HaloCodec::capacity()
+{
+    int packed = packedBytes();
+    return encoding_ == PACKED_RLE ? packed + (packed + 127) / 128 : packed;
+}
+
+// The loops below are not vectorized at -O2: the row length is unknown, and
+// the cheap cost model used at -O2 does not add the scalar epilogue. So on
+// x86-64, which always has SSE2, 16 cells are done per iteration by hand,
+// and the scalar loops finish the row (or do all of it on other targets).
+
+// 16 cells are narrowed to 0/1 bytes, moved to the sign bits and collected
+// with movemask, which gives LSB-first order
+void HaloCodec::packCells(const int *cells, int size, unsigned char *bits)
+{
+    int done = 0;
+#ifdef __SSE2__
+    for (; done + 16 <= size; done += 16)
+    {
+        __m128i low = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)(cells + done)),
+                                      _mm_loadu_si128((const __m128i *)(cells + done + 4)));
+        __m128i high = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)(cells + done + 8)),
+                                       _mm_loadu_si128((const __m128i *)(cells + done + 12)));
+        int mask = _mm_movemask_epi8(_mm_slli_epi16(_mm_packs_epi16(low, high), 7));
+        bits[done / 8] = (unsigned char)mask;
+        bits[done / 8 + 1] = (unsigned char)(mask >> 8);
+    }
+#endif
+    int full = size / 8;
+    for (int i = done / 8; i < full; i++)
+    {
+        const int *c = cells + 8 * i;
+        bits[i] = (unsigned char)(c[0] | c[1] << 1 | c[2] << 2 | c[3] << 3 | c[4] << 4 | c[5] << 5 | c[6] << 6 |
+                                  c[7] << 7);
+    }
+    if (size % 8)
+    {
+        unsigned char last = 0;
+        for (int j = 8 * full; j < size; j++)
+            last |= (unsigned char)(cells[j] << (j - 8 * full));
+        bits[full] = last;
+    }
+}
+
+// two bytes are spread over 16 byte lanes, each lane tests its own bit and
+// the 0/1 bytes are widened to ints
+void HaloCodec::unpackCells(const unsigned char *bits, int size, int *cells)
+{
+    int done = 0;
+#ifdef __SSE2__
+    const __m128i lane = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i zero = _mm_setzero_si128();
+    for (; done + 16 <= size; done += 16)
+    {
+        __m128i spread = _mm_cvtsi32_si128(bits[done / 8] | bits[done / 8 + 1] << 8);
+        spread = _mm_unpacklo_epi8(spread, spread);
+        spread = _mm_unpacklo_epi16(spread, spread);
+        spread = _mm_unpacklo_epi32(spread, spread);
+        __m128i set = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(spread, lane), lane), one);
+        __m128i low = _mm_unpacklo_epi8(set, zero);
+        __m128i high = _mm_unpackhi_epi8(set, zero);
+        _mm_storeu_si128((__m128i *)(cells + done), _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128((__m128i *)(cells + done + 4), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128((__m128i *)(cells + done + 8), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128((__m128i *)(cells + done + 12), _mm_unpackhi_epi16(high, zero));
+    }
+#endif
+    for (int j = done; j < size; j++)
+        cells[j] = (bits[j >> 3] >> (j & 7)) & 1;
+}
+
+// pollution <= 255 here, so the saturating packs are exact
+static void narrowRow(const int *pollution, int size, unsigned char *narrow)
+{
+    int done = 0;
+#ifdef __SSE2__
+    for (; done + 16 <= size; done += 16)
+    {
+        __m128i low = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)(pollution + done)),
+                                      _mm_loadu_si128((const __m128i *)(pollution + done + 4)));
+        __m128i high = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)(pollution + done + 8)),
+                                       _mm_loadu_si128((const __m128i *)(pollution + done + 12)));
+        _mm_storeu_si128((__m128i *)(narrow + done), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (int j = done; j < size; j++)
+        narrow[j] = (unsigned char)pollution[j];
+}
+
+static void widenRow(const unsigned char *narrow, int size, int *pollution)
+{
+    int done = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; done + 16 <= size; done += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(narrow + done));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_si128((__m128i *)(pollution + done), _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128((__m128i *)(pollution + done + 4), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128((__m128i *)(pollution + done + 8), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128((__m128i *)(pollution + done + 12), _mm_unpackhi_epi16(high, zero));
+    }
+#endif
+    for (int j = done; j < size; j++)
+        pollution[j] = narrow[j];
+}
+
+// PackBits: header h < 128 -> h + 1 literal bytes follow,
+// h > 128 -> the next byte repeats 257 - h times
+int HaloCodec::packBits(const unsigned char *in, int n, unsigned char *out)
+{
+    int written = 0;
+    int i = 0;
+    while (i < n)
+    {
+        int run = 1;
+        while (i + run < n && run < 128 && in[i + run] == in[i])
+            run++;
+        if (run >= 3)
+        {
+            out[written++] = (unsigned char)(257 - run);
+            out[written++] = in[i];
+            i += run;
+            continue;
+        }
+        // literal stretch up to the next run of 3
+        int start = i;
+        while (i < n && i - start < 128)
+        {
+            if (i + 2 < n && in[i] == in[i + 1] && in[i] == in[i + 2])
+                break;
+            i++;
+        }
+        out[written++] = (unsigned char)(i - start - 1);
+        memcpy(out + written, in + start, i - start);
+        written += i - start;
+    }
+    return written;
+}
+
+int HaloCodec::unpackBits(const unsigned char *in, int n, unsigned char *out)
+{
+    int written = 0;
+    int i = 0;
+    while (i < n)
+    {
+        int header = in[i++];
+        if (header < 128)
+        {
+            memcpy(out + written, in + i, header + 1);
+            written += header + 1;
+            i += header + 1;
+        }
+        else if (header > 128)
+        {
+            memset(out + written, in[i++], 257 - header);
+            written += 257 - header;
+        }
+    }
+    return written;
+}
+
+int HaloCodec::encode(const int *cells, const int *pollution, unsigned char *buffer)
+{
+    unsigned char *packed = encoding_ == PACKED_RLE ? scratch_ : buffer;
+    int bitBytes = (size_ + 7) / 8;
+    packCells(cells, size_, packed);
+    narrowRow(pollution, size_, packed + bitBytes);
+    if (encoding_ == PACKED_RLE)
+        return packBits(scratch_, packedBytes(), buffer);
+    return packedBytes();
+}
+
+void HaloCodec::decode(const unsigned char *buffer, int bytes, int *cells, int *pollution)
+{
+    const unsigned char *packed = buffer;
+    if (encoding_ == PACKED_RLE)
+    {
+        unpackBits(buffer, bytes, scratch_);
+        packed = scratch_;
+    }
+    int bitBytes = (size_ + 7) / 8;
+    unpackCells(packed, size_, cells);
+    widenRow(packed + bitBytes, size_, pollution);
+}
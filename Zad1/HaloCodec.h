@@ -0,0 +1,50 @@
+/*
+ * HaloCodec.h
+ */
+
+#ifndef HALOCODEC_H_
+#define HALOCODEC_H_
+
+// Wire format for one halo row: cells and pollution travel together in a
+// single message.
+//   PACKED: cells as bits (8 per byte, LSB first) followed by pollution as
+//           one byte per cell; needs getMaxPollution() <= 255
+//   PACKED_RLE: the PACKED bytes compressed with PackBits, which shrinks
+//           dead or steady stretches and grows by at most 1 byte per 128
+class HaloCodec
+{
+public:
+    enum Encoding
+    {
+        RAW, // two int rows, no codec
+        PACKED,
+        PACKED_RLE
+    };
+
+private:
+    Encoding encoding_;
+    int size_;                // cells per row
+    unsigned char *scratch_;  // PACKED bytes before RLE / after RLE decoding
+
+    int packedBytes();
+
+public:
+    HaloCodec(Encoding encoding, int size);
+    virtual ~HaloCodec();
+
+    // largest encoded row, the receive buffer size
+    int capacity();
+    // returns the number of bytes written to buffer
+    int encode(const int *cells, const int *pollution, unsigned char *buffer);
+    void decode(const unsigned char *buffer, int bytes, int *cells, int *pollution);
+
+    // "raw", "packed" or "rle"; RAW for anything else
+    static Encoding fromName(const char *name);
+
+    static void packCells(const int *cells, int size, unsigned char *bits);
+    static void unpackCells(const unsigned char *bits, int size, int *cells);
+    static int packBits(const unsigned char *in, int n, unsigned char *out);
+    static int unpackBits(const unsigned char *in, int n, unsigned char *out);
+};
+
+#endif /* HALOCODEC_H_ */
@@ -4,25 +4,86 @@
 
 #include "Life.h"
 #include "Alloc.h"
+#include "LifeTimers.h"
 
 Life::Life()
 {
+	rules = 0;
+	rowKernel = 0;
+	rowRules.rules = 0;
+	boundary = FIXED;
+	timers = 0;
+	snapshotter = 0;
+	snapshotPinned = false;
+	hashing = false;
+	hashTilesPerSide = 0;
+	tileHash = 0;
+	size = 0;
+	cells = cellsNext = pollution = pollutionNext = 0;
 }
 
 Life::~Life()
 {
+	freeTables();
+}
+
+// the four tables are the engine's, spares it handed to the snapshotter are
+// the snapshotter's; a snapshot still being drained reads the current ones
+void Life::freeTables()
+{
+	if (snapshotPinned)
+	{
+		snapshotter->flush();
+		snapshotPinned = false;
+	}
+	if (cells)
+	{
+		tableFree(cells, size);
+		tableFree(cellsNext, size);
+		tableFree(pollution, size);
+		tableFree(pollutionNext, size);
+		cells = cellsNext = pollution = pollutionNext = 0;
+	}
+	delete[] tileHash;
+	tileHash = 0;
 }
 
 void Life::setRules(Rules *rules)
 {
 	this->rules = rules;
+	this->rowKernel = selectRowKernel(rules, &rowRules);
+}
+
+void Life::setBoundary(Boundary boundary)
+{
+	this->boundary = boundary;
+}
+
+void Life::setTimers(LifeTimers *timers)
+{
+	this->timers = timers;
+}
+
+void Life::setSnapshotter(LifeSnapshotter *snapshotter)
+{
+	this->snapshotter = snapshotter;
+}
+
+void Life::snapshot(int generation)
+{
+	if (!snapshotter || snapshotPinned)
+		return;
+	LifeSnapshotter::View view = {generation, size, firstOwnedRow(), lastOwnedRow(), cells, pollution};
+	snapshotter->submit(view);
+	snapshotPinned = true;
 }
 
 void Life::setSize(int size)
 {
+	freeTables();
 	this->size = size;
 	this->size_1 = size - 1;
-	this->size_1_squared = size_1 * size_1;
+	this->size_1_squared = (long long)size_1 * size_1;
 	this->cells = tableAlloc(size);
 	this->cellsNext = tableAlloc(size);
 	this->pollution = tableAlloc(size);
@@ -31,6 +92,19 @@ void Life::setSize(int size)
 	clearTable(cellsNext, size);
 	clearTable(pollution, size);
 	clearTable(pollutionNext, size);
+	this->hashTilesPerSide = (size + HASH_TILE - 1) / HASH_TILE;
+	this->tileHash = new unsigned long long[hashTilesPerSide * hashTilesPerSide];
+	clearTileHashes();
+}
+
+// reuses the tables for a new run without reallocating them
+void Life::clear()
+{
+	clearTable(cells, size);
+	clearTable(cellsNext, size);
+	clearTable(pollution, size);
+	clearTable(pollutionNext, size);
+	clearTileHashes();
 }
 
 void Life::bringToLife(int row, int col)
@@ -50,6 +124,11 @@ int Life::getPollution(int row, int col)
 	return pollution[row][col];
 }
 
+int Life::getSize()
+{
+	return size;
+}
+
 int Life::getCellState(int row, int col)
 {
 	return cells[row][col];
@@ -69,6 +148,8 @@ void Life::swapTables()
 {
 	int **tmp;
 
+	if (timers)
+		timers->start(LifeTimers::SWAP);
 	tmp = cells;
 	cells = cellsNext;
 	cellsNext = tmp;
@@ -76,18 +157,138 @@ void Life::swapTables()
 	tmp = pollution;
 	pollution = pollutionNext;
 	pollutionNext = tmp;
+
+	// copy-on-swap: a snapshot still being drained keeps its tables and
+	// the next generation goes to a spare pair
+	if (snapshotPinned)
+	{
+		if (snapshotter->release(cellsNext, pollutionNext))
+			snapshotter->takeSpare(cellsNext, pollutionNext);
+		snapshotPinned = false;
+	}
+	if (timers)
+		timers->stop(LifeTimers::SWAP);
+}
+
+// for engines that overwrite the current tables in place: a snapshot still
+// being drained keeps them and the engine continues on a copy
+void Life::unpinSnapshot()
+{
+	if (!snapshotPinned)
+		return;
+	if (snapshotter->release(cells, pollution))
+	{
+		int **cellsCopy, **pollutionCopy;
+		snapshotter->takeSpare(cellsCopy, pollutionCopy);
+		copyTable(cells, cellsCopy, size);
+		copyTable(pollution, pollutionCopy, size);
+		cells = cellsCopy;
+		pollution = pollutionCopy;
+	}
+	snapshotPinned = false;
+}
+
+// wraps the last interior row into row 0 and the first one into row size_1
+void Life::fillRowHalo() {
+	for ( int col = 0; col < size; col++ ) {
+		cells[ 0 ][ col ] = cells[ size_1 - 1 ][ col ];
+		cells[ size_1 ][ col ] = cells[ 1 ][ col ];
+		pollution[ 0 ][ col ] = pollution[ size_1 - 1 ][ col ];
+		pollution[ size_1 ][ col ] = pollution[ 1 ][ col ];
+	}
 }
 
-int Life::sumTable( int **table ) {
-	int sum = 0;
+// rows already hold their halo rows, so the corners wrap correctly too
+void Life::fillColumnHalo( int firstRow, int lastRow ) {
+	for ( int row = firstRow; row < lastRow; row++ ) {
+		cells[ row ][ 0 ] = cells[ row ][ size_1 - 1 ];
+		cells[ row ][ size_1 ] = cells[ row ][ 1 ];
+		pollution[ row ][ 0 ] = pollution[ row ][ size_1 - 1 ];
+		pollution[ row ][ size_1 ] = pollution[ row ][ 1 ];
+	}
+}
+
+long long Life::sumTable( int **table ) {
+	long long sum = 0;
 	for ( int row = 1; row < size_1; row++ )
 		for( int col = 1; col < size_1; col++ )
 			sum += table[ row ][ col ];
 	return sum;
 }
 
+int Life::firstOwnedRow() {
+	return 1;
+}
+
+int Life::lastOwnedRow() {
+	return size_1;
+}
+
+void Life::setDistributedInit( bool ) {
+}
+
 void Life::beforeFirstStep() {
 }
 
 void Life::afterLastStep() {
-}
\ No newline at end of file
+}
+
+void Life::advance( int generations ) {
+	for ( int t = 0; t < generations; t++ )
+		oneStep();
+}
+static inline unsigned long long mixHash(unsigned long long key)
+{
+	key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+	return key ^ (key >> 31);
+}
+
+void Life::setHashing( bool hashing ) {
+	this->hashing = hashing;
+	if ( hashing )
+		rehash();
+}
+
+void Life::clearTileHashes() {
+	for ( int i = 0; i < hashTilesPerSide * hashTilesPerSide; i++ )
+		tileHash[ i ] = 0;
+}
+
+// contributions are summed, so tiles split between processes combine with
+// one MPI_SUM reduction; dead, clean cells add nothing
+void Life::hashRow( int **cellsT, int **pollutionT, int row ) {
+	unsigned long long *tiles = tileHash + ( row / HASH_TILE ) * hashTilesPerSide;
+	unsigned long long base = (unsigned long long)row * size;
+	for ( int col = 1; col < size_1; col++ ) {
+		unsigned long long state = cellsT[ row ][ col ] | ( pollutionT[ row ][ col ] << 1 );
+		if ( state )
+			tiles[ col / HASH_TILE ] += mixHash( ( ( base + col ) << 20 | state ) + 0x9E3779B97F4A7C15ULL );
+	}
+}
+
+void Life::rehash() {
+	clearTileHashes();
+	for ( int row = firstOwnedRow(); row < lastOwnedRow(); row++ )
+		hashRow( cells, pollution, row );
+}
+
+unsigned long long Life::localStateHash() {
+	unsigned long long sum = 0;
+	for ( int i = 0; i < hashTilesPerSide * hashTilesPerSide; i++ )
+		sum += tileHash[ i ];
+	return sum;
+}
+
+unsigned long long Life::stateHash() {
+	return localStateHash();
+}
+
+int Life::hashTiles() {
+	return hashTilesPerSide;
+}
+
+void Life::globalTileHashes( unsigned long long *hashes ) {
+	for ( int i = 0; i < hashTilesPerSide * hashTilesPerSide; i++ )
+		hashes[ i ] = tileHash[ i ];
+}
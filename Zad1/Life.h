@@ -6,38 +6,93 @@
 #define LIFE_H_
 
 #include "Rules.h"
+#include "RuleKernels.h"
+#include "LifeSnapshotter.h"
+
+class LifeTimers;
 
 class Life {
+public:
+	// FIXED: rows and cols 0 and size - 1 are a dead frame
+	// PERIODIC: the frame is a halo refilled from the opposite edge before
+	// every step, so the interior (size - 2) x (size - 2) board is a torus
+	enum Boundary { FIXED, PERIODIC };
 protected:
 	Rules *rules;
+	// row update chosen for rules by setRules, and what it is called with
+	RowKernel rowKernel;
+	RowRules rowRules;
 	int size;
 	int size_1;
-	int size_1_squared;
+	long long size_1_squared;
 	int **cells;
 	int **cellsNext;
 	int **pollution;
 	int **pollutionNext;
+	Boundary boundary;
+	LifeTimers *timers;
+	LifeSnapshotter *snapshotter;
+	bool snapshotPinned; // cells/pollution are being drained by the snapshotter
+	bool hashing;
+	int hashTilesPerSide;
+	unsigned long long *tileHash;
 	int liveNeighbours( int row, int col );
-	int sumTable( int **table );
+	long long sumTable( int **table );
 	void swapTables();
+	void unpinSnapshot();
+	void freeTables();
+	void fillRowHalo();
+	void fillColumnHalo( int firstRow, int lastRow );
+	void clearTileHashes();
+	void hashRow( int **cellsT, int **pollutionT, int row );
 	virtual void realStep() = 0;
 public:
 	Life();
 	virtual ~Life();
 	void setRules( Rules *rules );
-	void setSize( int size );
+	void setBoundary( Boundary boundary );
+	// optional phase timers, not owned; NULL disables them
+	void setTimers( LifeTimers *timers );
+	// optional snapshot sink, not owned; must outlive the engine
+	void setSnapshotter( LifeSnapshotter *snapshotter );
+	// hands the current generation of the owned rows to the snapshotter
+	// and returns at once, stepping goes on while it is drained
+	void snapshot( int generation );
+	virtual void setSize( int size );
 	void bringToLife( int row, int col );
+	void clear();
 	int getCellState( int row, int col );
+	int getSize();
 	int getPollution( int row, int col );
 
 	int **cellsTable();
 	int **pollutionTable();
 
+	// rows [first, last) computed by this process
+	virtual int firstOwnedRow();
+	virtual int lastOwnedRow();
+	// every process initialized its own rows, skip the scatter from rank 0
+	virtual void setDistributedInit( bool distributed );
+
+	// hash of cells and pollution kept per HASH_TILE x HASH_TILE tile,
+	// updated by realStep while the freshly computed row is still in cache
+	static const int HASH_TILE = 64;
+	void setHashing( bool hashing );
+	void rehash();
+	unsigned long long localStateHash();
+	virtual unsigned long long stateHash();
+	// per-tile hashes of the whole board, hashTilesPerSide^2 values in row-major order
+	int hashTiles();
+	virtual void globalTileHashes( unsigned long long *hashes );
+
 	virtual void beforeFirstStep();
 	virtual void afterLastStep();
-	virtual int numberOfLivingCells() = 0;
+	virtual long long numberOfLivingCells() = 0;
 	virtual double averagePollution() = 0;
 	virtual void oneStep() = 0;
+	// generations oneStep()s; engines that need no barrier between
+	// generations run them in one go
+	virtual void advance( int generations );
 };
 
 #endif /* LIFE_H_ */
\ No newline at end of file
@@ -0,0 +1,176 @@
+/*
+ * LifeAutotuner.cpp
+ */
+
+#include "LifeAutotuner.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+LifeAutotuner::LifeAutotuner(MPI_Comm comm)
+{
+    comm_ = comm;
+    MPI_Comm_rank(comm_, &rank_);
+    MPI_Comm_size(comm_, &procSize_);
+    probeSteps_ = 5;
+    log_ = NULL;
+}
+
+void LifeAutotuner::setProbeSteps(int steps)
+{
+    probeSteps_ = steps > 0 ? steps : 1;
+}
+
+void LifeAutotuner::setCacheFile(const string &fileName)
+{
+    cacheFile_ = fileName;
+}
+
+void LifeAutotuner::setLog(ostream *log)
+{
+    log_ = log;
+}
+
+// rank 0's host stands for the whole job
+string LifeAutotuner::key(int size)
+{
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    ostringstream out;
+    out << host << " " << size << " " << procSize_;
+    return out.str();
+}
+
+// the last matching line wins, so a retuned entry overrides older ones
+bool LifeAutotuner::cached(const string &key, LifeEngineConfig &config)
+{
+    ifstream in(cacheFile_.c_str());
+    string line;
+    bool found = false;
+    istringstream keyFields(key);
+    string host, size, procs;
+    keyFields >> host >> size >> procs;
+    while (getline(in, line))
+    {
+        istringstream fields(line);
+        string lineHost, lineSize, lineProcs, rest;
+        if (!(fields >> lineHost >> lineSize >> lineProcs))
+            continue;
+        if (lineHost != host || lineSize != size || lineProcs != procs)
+            continue;
+        getline(fields, rest);
+        found |= config.parse(rest);
+    }
+    return found;
+}
+
+void LifeAutotuner::store(const string &key, const LifeEngineConfig &config)
+{
+    ofstream out(cacheFile_.c_str(), ios::app);
+    if (out)
+        out << key << " " << config.describe() << endl;
+}
+
+void LifeAutotuner::broadcast(LifeEngineConfig &config)
+{
+    string line = config.describe();
+    int length = (int)line.size();
+    MPI_Bcast(&length, 1, MPI_INT, 0, comm_);
+    line.resize(length);
+    MPI_Bcast(&line[0], length, MPI_CHAR, 0, comm_);
+    config.parse(line);
+}
+
+vector<LifeEngineConfig> LifeAutotuner::candidates()
+{
+    vector<LifeEngineConfig> configs;
+    vector<string> names = lifeEngineNames();
+    unsigned hardware = thread::hardware_concurrency();
+    int maxThreads = hardware ? (int)hardware : 1;
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        if (names[i] == "dataflow")
+        {
+            for (int threads = maxThreads;; threads /= 2)
+            {
+                for (int tileSize = 32; tileSize <= 128; tileSize *= 2)
+                    configs.push_back(LifeEngineConfig(names[i], threads, tileSize));
+                if (threads == 1)
+                    break;
+            }
+        }
+        else if (names[i] == "parallel")
+        {
+            configs.push_back(LifeEngineConfig(names[i], 0, 0, HaloCodec::RAW));
+            configs.push_back(LifeEngineConfig(names[i], 0, 0, HaloCodec::PACKED));
+            configs.push_back(LifeEngineConfig(names[i], 0, 0, HaloCodec::PACKED_RLE));
+        }
+        else if (names[i] != "parallel-packed" && names[i] != "parallel-rle") // covered by parallel
+        {
+            configs.push_back(LifeEngineConfig(names[i]));
+        }
+    }
+    return configs;
+}
+
+double LifeAutotuner::probe(const LifeEngineConfig &config, Prepare prepare, void *arg)
+{
+    Life *life = createLifeEngine(config, comm_);
+    if (!life)
+        return -1.0;
+    prepare(life, arg);
+    life->beforeFirstStep();
+    life->oneStep(); // first touch of the tables, thread start-up
+
+    MPI_Barrier(comm_);
+    double start = MPI_Wtime();
+    life->advance(probeSteps_);
+    double local = MPI_Wtime() - start, slowest;
+    MPI_Allreduce(&local, &slowest, 1, MPI_DOUBLE, MPI_MAX, comm_);
+    delete life;
+    return slowest / probeSteps_;
+}
+
+LifeEngineConfig LifeAutotuner::tune(int size, Prepare prepare, void *arg, bool useCache)
+{
+    LifeEngineConfig best;
+    string tuningKey = key(size);
+    int hit = 0;
+    if (!rank_ && useCache && !cacheFile_.empty())
+        hit = cached(tuningKey, best);
+    MPI_Bcast(&hit, 1, MPI_INT, 0, comm_);
+    if (hit)
+    {
+        broadcast(best);
+        if (log_)
+            *log_ << "autotune: cached " << best.describe() << endl;
+        return best;
+    }
+
+    vector<LifeEngineConfig> configs = candidates();
+    double bestTime = -1.0;
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+        double seconds = probe(configs[i], prepare, arg);
+        if (seconds < 0.0)
+            continue;
+        if (log_)
+            *log_ << "autotune: " << configs[i].describe() << " " << seconds << " s/step" << endl;
+        if (bestTime < 0.0 || seconds < bestTime)
+        {
+            bestTime = seconds;
+            best = configs[i];
+        }
+    }
+    // every rank measured the same maxima, rank 0 still decides for safety
+    broadcast(best);
+    if (!rank_ && !cacheFile_.empty())
+        store(tuningKey, best);
+    if (log_)
+        *log_ << "autotune: chose " << best.describe() << endl;
+    return best;
+}
@@ -0,0 +1,58 @@
+/*
+ * LifeAutotuner.h
+ */
+
+#ifndef LIFEAUTOTUNER_H_
+#define LIFEAUTOTUNER_H_
+
+#include "LifeEngines.h"
+
+#include <mpi.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Chooses the engine configuration for a board by running a few probe steps
+// of every candidate on the real initial state and the real processes. The
+// winner is cached in a text file, one line per "host size procs" key, so
+// the next run on the same kind of node skips the probing:
+//   node17 7500 1 dataflow threads=16 tile=128 halo=raw
+class LifeAutotuner
+{
+public:
+    // sets rules, boundary and size of a fresh engine and places the initial state
+    typedef void (*Prepare)(Life *life, void *arg);
+
+private:
+    MPI_Comm comm_;
+    int rank_;
+    int procSize_;
+    int probeSteps_;
+    std::string cacheFile_;
+    std::ostream *log_;
+
+    std::string key(int size);
+    bool cached(const std::string &key, LifeEngineConfig &config);
+    void store(const std::string &key, const LifeEngineConfig &config);
+    void broadcast(LifeEngineConfig &config);
+
+public:
+    LifeAutotuner(MPI_Comm comm = MPI_COMM_WORLD);
+
+    void setProbeSteps(int steps);
+    // empty name disables the cache
+    void setCacheFile(const std::string &fileName);
+    // probe times go here (rank 0 only); NULL keeps quiet
+    void setLog(std::ostream *log);
+
+    // registered engines with their knobs expanded: tile sizes and thread
+    // counts for dataflow, halo encodings for parallel
+    std::vector<LifeEngineConfig> candidates();
+    // collective; seconds per step of the slowest process, < 0 if the
+    // configuration cannot run on the communicator
+    double probe(const LifeEngineConfig &config, Prepare prepare, void *arg);
+    // collective; the same configuration on every process
+    LifeEngineConfig tune(int size, Prepare prepare, void *arg, bool useCache = true);
+};
+
+#endif /* LIFEAUTOTUNER_H_ */
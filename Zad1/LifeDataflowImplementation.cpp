@@ -0,0 +1,542 @@
+/*
+ * LifeDataflowImplementation.cpp
+ */
+
+#include "LifeDataflowImplementation.h"
+#include "LifeTimers.h"
+
+#include <algorithm>
+
+// tags 0 .. 3 belong to the generation 0 border row exchange
+static const int TILE_TAG = 4;
+
+LifeDataflowImplementation::LifeDataflowImplementation(MPI_Comm comm) : LifeParallelImplementation(comm)
+{
+    unsigned hardware = std::thread::hardware_concurrency();
+    threads_ = hardware ? (int)hardware : 1;
+    tileSize_ = 64;
+    tilesPerSide_ = 0;
+    tileRows_ = 0;
+    target_ = 0;
+    up_ = down_ = MPI_PROC_NULL;
+}
+
+LifeDataflowImplementation::~LifeDataflowImplementation()
+{
+    stopWorkers();
+}
+
+void LifeDataflowImplementation::setThreads(int threads)
+{
+    threads_ = threads > 0 ? threads : 1;
+}
+
+void LifeDataflowImplementation::setTileSize(int tileSize)
+{
+    tileSize_ = tileSize > 0 ? tileSize : 1;
+}
+
+void LifeDataflowImplementation::setSize(int size)
+{
+    stopWorkers();
+    LifeParallelImplementation::setSize(size);
+    tilesPerSide_ = (size - 2 + tileSize_ - 1) / tileSize_;
+    if (tilesPerSide_ < 1)
+        tilesPerSide_ = 1;
+    tileRows_ = (lastRow_ - firstRow_ + tileSize_ - 1) / tileSize_;
+    if (tileRows_ < 1)
+        tileRows_ = 1;
+    int tiles = tileRows_ * tilesPerSide_;
+    generation_ = std::vector<std::atomic<int>>(tiles);
+    queued_ = std::vector<std::atomic<bool>>(tiles);
+    for (int side = 0; side < 2; side++)
+    {
+        haloGeneration_[side] = std::vector<std::atomic<int>>(tilesPerSide_);
+        segments_[side] = std::vector<HaloSegment>(tilesPerSide_);
+    }
+    receives_.assign(2 * tilesPerSide_, MPI_REQUEST_NULL);
+    completed_.resize(2 * tilesPerSide_);
+    queues_ = std::vector<WorkerQueue>(threads_);
+    startWorkers();
+}
+
+void LifeDataflowImplementation::startWorkers()
+{
+    stop_ = false;
+    for (int worker = 1; worker < threads_; worker++)
+        workers_.push_back(std::thread(&LifeDataflowImplementation::workerLoop, this, worker));
+}
+
+void LifeDataflowImplementation::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> guard(runLock_);
+        stop_ = true;
+    }
+    runStart_.notify_all();
+    for (size_t i = 0; i < workers_.size(); i++)
+        workers_[i].join();
+    workers_.clear();
+}
+
+// pool threads sleep between advance() calls
+void LifeDataflowImplementation::workerLoop(int worker)
+{
+    int seen = 0;
+    std::unique_lock<std::mutex> guard(runLock_);
+    for (;;)
+    {
+        runStart_.wait(guard, [&] { return stop_ || run_ != seen; });
+        if (stop_)
+            return;
+        seen = run_;
+        guard.unlock();
+        work(worker);
+        guard.lock();
+        finished_++;
+        runEnd_.notify_one();
+    }
+}
+
+void LifeDataflowImplementation::work(int worker)
+{
+    int tile;
+    while (remaining_.load() > 0)
+    {
+        if (worker == 0 && procSize_ > 1)
+            progressHalos();
+        if (pop(worker, tile))
+            computeTile(worker, tile);
+        else
+            std::this_thread::yield();
+    }
+}
+
+// own deque from the back (the tile just scheduled, still in cache),
+// the other deques from the front
+bool LifeDataflowImplementation::pop(int worker, int &tile)
+{
+    for (int i = 0; i < threads_; i++)
+    {
+        WorkerQueue &queue = queues_[(worker + i) % threads_];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tiles.empty())
+            continue;
+        if (i == 0)
+        {
+            tile = queue.tiles.back();
+            queue.tiles.pop_back();
+        }
+        else
+        {
+            tile = queue.tiles.front();
+            queue.tiles.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+// -1 outside a bounded board and outside the band of this process; rows
+// only wrap when one process holds the whole torus
+int LifeDataflowImplementation::neighbour(int tileRow, int tileCol, int dRow, int dCol)
+{
+    int row = tileRow + dRow;
+    int col = tileCol + dCol;
+    if (boundary == PERIODIC)
+    {
+        if (procSize_ == 1)
+            row = (row + tileRows_) % tileRows_;
+        col = (col + tilesPerSide_) % tilesPerSide_;
+    }
+    if (row < 0 || row >= tileRows_ || col < 0 || col >= tilesPerSide_)
+        return -1;
+    return row * tilesPerSide_ + col;
+}
+
+void LifeDataflowImplementation::tileBounds(int tile, int &firstRow, int &lastRow, int &firstCol, int &lastCol)
+{
+    firstRow = firstRow_ + tile / tilesPerSide_ * tileSize_;
+    lastRow = firstRow + tileSize_ < lastRow_ ? firstRow + tileSize_ : lastRow_;
+    columnBounds(tile % tilesPerSide_, firstCol, lastCol);
+}
+
+void LifeDataflowImplementation::columnBounds(int tileCol, int &firstCol, int &lastCol)
+{
+    firstCol = 1 + tileCol * tileSize_;
+    lastCol = firstCol + tileSize_ < size_1 ? firstCol + tileSize_ : size_1;
+}
+
+// a tile next to the halo row reads its own column and the two beside it
+bool LifeDataflowImplementation::haloReady(int side, int tileCol, int g)
+{
+    for (int dCol = -1; dCol <= 1; dCol++)
+    {
+        int col = tileCol + dCol;
+        if (boundary == PERIODIC)
+            col = (col + tilesPerSide_) % tilesPerSide_;
+        else if (col < 0 || col >= tilesPerSide_)
+            continue;
+        if (haloGeneration_[side][col].load() < g)
+            return false;
+    }
+    return true;
+}
+
+bool LifeDataflowImplementation::ready(int tile)
+{
+    int g = generation_[tile].load();
+    if (g >= target_)
+        return false;
+    int tileRow = tile / tilesPerSide_;
+    int tileCol = tile % tilesPerSide_;
+    for (int dRow = -1; dRow <= 1; dRow++)
+        for (int dCol = -1; dCol <= 1; dCol++)
+        {
+            int other = neighbour(tileRow, tileCol, dRow, dCol);
+            if (other >= 0 && generation_[other].load() < g)
+                return false;
+        }
+    if (tileRow == 0 && up_ != MPI_PROC_NULL && !haloReady(0, tileCol, g))
+        return false;
+    if (tileRow == tileRows_ - 1 && down_ != MPI_PROC_NULL && !haloReady(1, tileCol, g))
+        return false;
+    return true;
+}
+
+// readiness only changes when the tile itself is computed, so the flag
+// needs one re-check after winning it: another thread may have run the
+// tile between our check and the CAS
+void LifeDataflowImplementation::trySchedule(int worker, int tile)
+{
+    while (ready(tile))
+    {
+        bool expected = false;
+        if (!queued_[tile].compare_exchange_strong(expected, true))
+            return; // queued or running; whoever holds the flag re-checks
+        if (ready(tile))
+        {
+            WorkerQueue &queue = queues_[worker];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.tiles.push_back(tile);
+            return;
+        }
+        queued_[tile].store(false);
+    }
+}
+
+void LifeDataflowImplementation::computeTile(int worker, int tile)
+{
+    int g = generation_[tile].load();
+    int **c = tables_[g % 2][0];
+    int **p = tables_[g % 2][1];
+    int **cn = tables_[(g + 1) % 2][0];
+    int **pn = tables_[(g + 1) % 2][1];
+    int tileRow = tile / tilesPerSide_;
+    int tileCol = tile % tilesPerSide_;
+    int firstRow, lastRow, firstCol, lastCol;
+    tileBounds(tile, firstRow, lastRow, firstCol, lastCol);
+
+    for (int row = firstRow; row < lastRow; row++)
+        rowKernel(&rowRules, c, p, cn, pn, row, firstCol, lastCol);
+    if (boundary == PERIODIC)
+        publishHalo(tile, (g + 1) % 2);
+    if (g + 1 < target_)
+        queueHalo(tile, g + 1);
+
+    generation_[tile].store(g + 1);
+    queued_[tile].store(false);
+    remaining_.fetch_sub(1);
+    for (int dRow = -1; dRow <= 1; dRow++)
+        for (int dCol = -1; dCol <= 1; dCol++)
+        {
+            int other = neighbour(tileRow, tileCol, dRow, dCol);
+            if (other >= 0)
+                trySchedule(worker, other);
+        }
+}
+
+// on a torus the halo of a generation is written by the tiles owning the
+// wrapped cells, right after computing them; every halo cell has exactly one
+// writer and a tile reading it depends on that writer anyway
+void LifeDataflowImplementation::publishHalo(int tile, int parity)
+{
+    int **c = tables_[parity][0];
+    int **p = tables_[parity][1];
+    int firstRow, lastRow, firstCol, lastCol;
+    tileBounds(tile, firstRow, lastRow, firstCol, lastCol);
+
+    for (int row = firstRow; row < lastRow; row++)
+    {
+        if (firstCol == 1)
+        {
+            c[row][size_1] = c[row][1];
+            p[row][size_1] = p[row][1];
+        }
+        if (lastCol == size_1)
+        {
+            c[row][0] = c[row][size_1 - 1];
+            p[row][0] = p[row][size_1 - 1];
+        }
+    }
+    // rows 1 and size_1 - 1 wrap with their corners; between processes the
+    // halo messages carry them
+    if (procSize_ > 1)
+        return;
+    int edges[2][2] = {{1, size_1}, {size_1 - 1, 0}};
+    for (int e = 0; e < 2; e++)
+    {
+        int from = edges[e][0];
+        int to = edges[e][1];
+        if (from < firstRow || from >= lastRow)
+            continue;
+        for (int col = firstCol; col < lastCol; col++)
+        {
+            c[to][col] = c[from][col];
+            p[to][col] = p[from][col];
+        }
+        if (firstCol == 1)
+        {
+            c[to][size_1] = c[from][1];
+            p[to][size_1] = p[from][1];
+        }
+        if (lastCol == size_1)
+        {
+            c[to][0] = c[from][size_1 - 1];
+            p[to][0] = p[from][size_1 - 1];
+        }
+    }
+}
+
+void LifeDataflowImplementation::realStep()
+{
+    // generation 2 is written over generation 0
+    if (target_ > 1)
+        unpinSnapshot();
+    tables_[0][0] = cells;
+    tables_[0][1] = pollution;
+    tables_[1][0] = cellsNext;
+    tables_[1][1] = pollutionNext;
+    if (procSize_ > 1)
+    {
+        // generation 0 crosses in whole rows, the later ones per tile column
+        exchangeBorderRowsInfo();
+        if (boundary == PERIODIC)
+            fillColumnHalo(firstRow_ - 1, lastRow_ + 1);
+        startHaloExchange();
+    }
+    else if (boundary == PERIODIC)
+    {
+        fillRowHalo();
+        fillColumnHalo(0, size);
+    }
+
+    int tiles = tileRows_ * tilesPerSide_;
+    for (int tile = 0; tile < tiles; tile++)
+    {
+        generation_[tile].store(0);
+        queued_[tile].store(false);
+    }
+    remaining_.store((long long)tiles * target_);
+    // contiguous bands of tile rows per thread to start with
+    for (int tile = 0; tile < tiles; tile++)
+        trySchedule((int)((long long)(tile / tilesPerSide_) * threads_ / tileRows_), tile);
+
+    {
+        std::lock_guard<std::mutex> guard(runLock_);
+        finished_ = 0;
+        run_++;
+    }
+    runStart_.notify_all();
+    work(0);
+    if (procSize_ > 1)
+        finishHaloExchange();
+    std::unique_lock<std::mutex> guard(runLock_);
+    runEnd_.wait(guard, [&] { return finished_ == threads_ - 1; });
+}
+
+// tiles run ahead of each other up to the whole distance, so generations
+// have no boundary to time at: the timers get one step of all of them
+void LifeDataflowImplementation::advance(int generations)
+{
+    if (generations <= 0)
+        return;
+    if (timers)
+        timers->start(LifeTimers::COMPUTE);
+    target_ = generations;
+    realStep();
+    if (timers)
+        timers->stop(LifeTimers::COMPUTE);
+    if (generations % 2)
+        swapTables();
+    if (hashing)
+        rehash();
+    if (timers)
+        timers->nextStep(generations);
+}
+
+void LifeDataflowImplementation::oneStep()
+{
+    advance(1);
+}
+
+// the border row segment of a freshly computed tile goes to the neighbour
+// process right away; thread 0 posts the send
+void LifeDataflowImplementation::queueHalo(int tile, int g)
+{
+    int tileRow = tile / tilesPerSide_;
+    int firstRow, lastRow, firstCol, lastCol;
+    tileBounds(tile, firstRow, lastRow, firstCol, lastCol);
+    int **c = tables_[g % 2][0];
+    int **p = tables_[g % 2][1];
+    for (int side = 0; side < 2; side++)
+    {
+        int to = side ? down_ : up_;
+        if (to == MPI_PROC_NULL || tileRow != (side ? tileRows_ - 1 : 0) || firstRow == lastRow)
+            continue;
+        int row = side ? lastRow - 1 : firstRow;
+        HaloMessage *message = new HaloMessage;
+        message->side = 1 - side; // our top row is the halo below the process above
+        message->tileCol = tile % tilesPerSide_;
+        message->data.assign(c[row] + firstCol, c[row] + lastCol);
+        message->data.insert(message->data.end(), p[row] + firstCol, p[row] + lastCol);
+        std::lock_guard<std::mutex> guard(outboxLock_);
+        outbox_.push_back(message);
+    }
+}
+
+// side and column in the tag keep the segments apart, even when up_ == down_
+int LifeDataflowImplementation::haloTag(int side, int tileCol)
+{
+    return TILE_TAG + side * tilesPerSide_ + tileCol;
+}
+
+void LifeDataflowImplementation::postHaloReceive(int side, int tileCol)
+{
+    HaloSegment &segment = segments_[side][tileCol];
+    int firstCol, lastCol;
+    columnBounds(tileCol, firstCol, lastCol);
+    segment.buffer.resize(2 * (lastCol - firstCol));
+    MPI_Irecv(segment.buffer.data(), (int)segment.buffer.size(), MPI_INT, side ? down_ : up_,
+              haloTag(side, tileCol), comm_, &receives_[side * tilesPerSide_ + tileCol]);
+    segment.posted++;
+}
+
+// generations 1 .. target_ - 1 arrive per segment, one receive in flight each
+void LifeDataflowImplementation::startHaloExchange()
+{
+    neighbours(up_, down_);
+    for (int side = 0; side < 2; side++)
+        for (int tileCol = 0; tileCol < tilesPerSide_; tileCol++)
+        {
+            HaloSegment &segment = segments_[side][tileCol];
+            haloGeneration_[side][tileCol].store(0);
+            segment.posted = 0;
+            segment.arrived.clear();
+            if ((side ? down_ : up_) != MPI_PROC_NULL && target_ > 1)
+                postHaloReceive(side, tileCol);
+        }
+}
+
+void LifeDataflowImplementation::progressHalos()
+{
+    std::vector<HaloMessage *> queued;
+    {
+        std::lock_guard<std::mutex> guard(outboxLock_);
+        queued.swap(outbox_);
+    }
+    for (size_t i = 0; i < queued.size(); i++)
+    {
+        HaloMessage *message = queued[i];
+        MPI_Isend(message->data.data(), (int)message->data.size(), MPI_INT, message->side ? up_ : down_,
+                  haloTag(message->side, message->tileCol), comm_, &message->request);
+        haloBytesSent_ += message->data.size() * sizeof(int);
+        sending_.push_back(message);
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < sending_.size(); i++)
+    {
+        int done;
+        MPI_Test(&sending_[i]->request, &done, MPI_STATUS_IGNORE);
+        if (done)
+            delete sending_[i];
+        else
+            sending_[kept++] = sending_[i];
+    }
+    sending_.resize(kept);
+
+    int count;
+    MPI_Testsome((int)receives_.size(), receives_.data(), &count, completed_.data(), MPI_STATUSES_IGNORE);
+    for (int i = 0; i < count && count != MPI_UNDEFINED; i++)
+    {
+        int side = completed_[i] / tilesPerSide_;
+        int tileCol = completed_[i] % tilesPerSide_;
+        HaloSegment &segment = segments_[side][tileCol];
+        segment.arrived.push_back(std::vector<int>());
+        segment.arrived.back().swap(segment.buffer);
+        if (segment.posted < target_ - 1)
+            postHaloReceive(side, tileCol);
+    }
+    for (int side = 0; side < 2; side++)
+        for (int tileCol = 0; tileCol < tilesPerSide_; tileCol++)
+            while (unpackHalo(side, tileCol))
+                ;
+}
+
+// generation g lands in the table the border tiles read for generation
+// g - 1, so it waits until the three tiles around the column are past it
+bool LifeDataflowImplementation::unpackHalo(int side, int tileCol)
+{
+    HaloSegment &segment = segments_[side][tileCol];
+    if (segment.arrived.empty())
+        return false;
+    int g = haloGeneration_[side][tileCol].load() + 1;
+    int tileRow = side ? tileRows_ - 1 : 0;
+    for (int dCol = -1; dCol <= 1; dCol++)
+    {
+        int other = neighbour(tileRow, tileCol, 0, dCol);
+        if (other >= 0 && generation_[other].load() < g - 1)
+            return false;
+    }
+
+    int **c = tables_[g % 2][0];
+    int **p = tables_[g % 2][1];
+    int row = side ? lastRow_ : firstRow_ - 1;
+    int firstCol, lastCol;
+    columnBounds(tileCol, firstCol, lastCol);
+    const std::vector<int> &data = segment.arrived.front();
+    int width = lastCol - firstCol;
+    std::copy(data.begin(), data.begin() + width, c[row] + firstCol);
+    std::copy(data.begin() + width, data.end(), p[row] + firstCol);
+    if (boundary == PERIODIC)
+    {
+        if (firstCol == 1)
+        {
+            c[row][size_1] = c[row][1];
+            p[row][size_1] = p[row][1];
+        }
+        if (lastCol == size_1)
+        {
+            c[row][0] = c[row][size_1 - 1];
+            p[row][0] = p[row][size_1 - 1];
+        }
+    }
+    segment.arrived.pop_front();
+
+    haloGeneration_[side][tileCol].store(g);
+    for (int dCol = -1; dCol <= 1; dCol++)
+    {
+        int other = neighbour(tileRow, tileCol, 0, dCol);
+        if (other >= 0)
+            trySchedule(0, other);
+    }
+    return true;
+}
+
+// every receive was needed by some tile, so only sends can be left
+void LifeDataflowImplementation::finishHaloExchange()
+{
+    while (!outbox_.empty() || !sending_.empty())
+        progressHalos();
+    MPI_Waitall((int)receives_.size(), receives_.data(), MPI_STATUSES_IGNORE);
+}
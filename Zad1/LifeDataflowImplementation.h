@@ -0,0 +1,127 @@
+/*
+ * LifeDataflowImplementation.h
+ */
+
+#ifndef LIFEDATAFLOWIMPLEMENTATION_H_
+#define LIFEDATAFLOWIMPLEMENTATION_H_
+
+#include "LifeParallelImplementation.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Life without a global barrier between generations. The rows of this
+// process (the row bands of the parallel engine) are cut into tileSize x
+// tileSize tiles and computing one tile one generation ahead is a task: tile
+// T may go from generation g to g + 1 as soon as every tile of its 3x3
+// neighbourhood (wrapped on a torus) has reached g. Generation g of every
+// tile lives in table g % 2, which is safe because neighbouring tiles never
+// drift more than one generation apart, so the global swap disappears and
+// distant regions run ahead of each other within one advance(). Tasks run on
+// a pool of threads with a deque each; a thread pops its own newest task and
+// steals the oldest one of another thread when it runs dry.
+//
+// With more processes the tiles of the first and last tile row also depend
+// on the halo row above / below, one segment per tile column: the segments
+// of generation g of the three columns around the tile must have arrived.
+// A border tile sends its border row segment as soon as it has computed it,
+// so a process only ever waits for the columns it actually needs. Only the
+// calling thread talks to MPI (MPI_THREAD_FUNNELED is enough): between tasks
+// it posts the queued sends, completes receives and unpacks them.
+class LifeDataflowImplementation : public LifeParallelImplementation
+{
+private:
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex lock;
+        std::deque<int> tiles;
+    };
+
+    // one border row segment, cells then pollution of one tile column
+    struct HaloMessage
+    {
+        int side;                          // halo of the receiver it fills, 0 above, 1 below
+        int tileCol;
+        std::vector<int> data;
+        MPI_Request request;
+    };
+
+    // the halo of one tile column on one side; messages arrive in generation
+    // order and are unpacked once the tiles reading the table are done
+    struct HaloSegment
+    {
+        std::vector<int> buffer;           // of the posted receive
+        int posted = 0;                    // receives posted in this advance()
+        std::deque<std::vector<int>> arrived;
+    };
+
+    int threads_;
+    int tileSize_;
+    int tilesPerSide_;                     // tile columns
+    int tileRows_;                         // tile rows of this process
+    int target_;                           // generation every tile runs to
+    int **tables_[2][2];                   // [generation % 2][cells, pollution]
+    std::vector<std::atomic<int>> generation_; // per tile, relative to the advance() start
+    std::vector<std::atomic<bool>> queued_;    // tile is in a deque or being computed
+    std::atomic<long long> remaining_;     // tile generations still to compute
+    std::vector<WorkerQueue> queues_;
+
+    int up_, down_;                        // neighbour processes or MPI_PROC_NULL
+    std::vector<std::atomic<int>> haloGeneration_[2]; // [above, below] per tile column
+    std::vector<HaloSegment> segments_[2];
+    std::vector<MPI_Request> receives_;   // [side * tilesPerSide_ + tileCol]
+    std::vector<int> completed_;          // MPI_Testsome indices
+    std::mutex outboxLock_;
+    std::vector<HaloMessage *> outbox_;    // computed, not sent yet
+    std::vector<HaloMessage *> sending_;   // MPI_Isend posted
+
+    std::vector<std::thread> workers_;     // threads 1 .. threads_ - 1, thread 0 is the caller
+    std::mutex runLock_;
+    std::condition_variable runStart_;
+    std::condition_variable runEnd_;
+    int run_ = 0;                          // advance() counter the workers wait on
+    int finished_ = 0;                     // workers done with the current run
+    bool stop_ = false;
+
+    void startWorkers();
+    void stopWorkers();
+    void workerLoop(int worker);
+    void work(int worker);
+    bool pop(int worker, int &tile);
+    bool ready(int tile);
+    void trySchedule(int worker, int tile);
+    void computeTile(int worker, int tile);
+    void publishHalo(int tile, int parity);
+    int neighbour(int tileRow, int tileCol, int dRow, int dCol);
+    void tileBounds(int tile, int &firstRow, int &lastRow, int &firstCol, int &lastCol);
+    void columnBounds(int tileCol, int &firstCol, int &lastCol);
+    bool haloReady(int side, int tileCol, int g);
+    void queueHalo(int tile, int g);
+    void startHaloExchange();
+    void progressHalos();
+    int haloTag(int side, int tileCol);
+    void postHaloReceive(int side, int tileCol);
+    bool unpackHalo(int side, int tileCol);
+    void finishHaloExchange();
+
+protected:
+    void realStep();
+
+public:
+    LifeDataflowImplementation(MPI_Comm comm = MPI_COMM_WORLD);
+    virtual ~LifeDataflowImplementation();
+
+    // both take effect on the next setSize()
+    void setThreads(int threads);
+    void setTileSize(int tileSize);
+    void setSize(int size) override;
+
+    void oneStep() override;
+    void advance(int generations) override;
+};
+
+#endif /* LIFEDATAFLOWIMPLEMENTATION_H_ */
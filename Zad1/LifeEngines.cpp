@@ -0,0 +1,145 @@
+/*
+ * LifeEngines.cpp
+ */
+
+#include "LifeEngines.h"
+#include "LifeDataflowImplementation.h"
+#include "LifeParallelImplementation.h"
+#include "LifeSequentialImplementation.h"
+
+#include <cstdlib>
+#include <sstream>
+
+using namespace std;
+
+LifeEngineConfig::LifeEngineConfig(const string &engine, int threads, int tileSize, HaloCodec::Encoding halo)
+    : engine(engine), threads(threads), tileSize(tileSize), halo(halo)
+{
+}
+
+static const char *haloNames[] = {"raw", "packed", "rle"};
+
+string LifeEngineConfig::describe() const
+{
+    ostringstream out;
+    out << engine << " threads=" << threads << " tile=" << tileSize << " halo=" << haloNames[halo];
+    return out.str();
+}
+
+bool LifeEngineConfig::parse(const string &line)
+{
+    istringstream in(line);
+    string field;
+    if (!(in >> engine))
+        return false;
+    threads = tileSize = 0;
+    halo = HaloCodec::RAW;
+    while (in >> field)
+    {
+        size_t eq = field.find('=');
+        if (eq == string::npos)
+            continue;
+        string key = field.substr(0, eq);
+        string value = field.substr(eq + 1);
+        if (key == "threads")
+            threads = atoi(value.c_str());
+        else if (key == "tile")
+            tileSize = atoi(value.c_str());
+        else if (key == "halo")
+            halo = HaloCodec::fromName(value.c_str());
+    }
+    return true;
+}
+
+static int commSize(MPI_Comm comm)
+{
+    int procs;
+    MPI_Comm_size(comm, &procs);
+    return procs;
+}
+
+static Life *createSequential(const LifeEngineConfig &, MPI_Comm comm)
+{
+    return commSize(comm) == 1 ? new LifeSequentialImplementation() : NULL;
+}
+
+static Life *createDataflow(const LifeEngineConfig &config, MPI_Comm comm)
+{
+    LifeDataflowImplementation *life = new LifeDataflowImplementation(comm);
+    if (config.threads > 0)
+        life->setThreads(config.threads);
+    if (config.tileSize > 0)
+        life->setTileSize(config.tileSize);
+    return life;
+}
+
+static Life *createParallel(const LifeEngineConfig &config, MPI_Comm comm)
+{
+    LifeParallelImplementation *life = new LifeParallelImplementation(comm);
+    life->setHaloEncoding(config.halo);
+    return life;
+}
+
+static Life *createParallelPacked(const LifeEngineConfig &config, MPI_Comm comm)
+{
+    LifeEngineConfig packed = config;
+    packed.halo = HaloCodec::PACKED;
+    return createParallel(packed, comm);
+}
+
+static Life *createParallelRLE(const LifeEngineConfig &config, MPI_Comm comm)
+{
+    LifeEngineConfig rle = config;
+    rle.halo = HaloCodec::PACKED_RLE;
+    return createParallel(rle, comm);
+}
+
+// name order is the order of lifeEngineNames()
+static vector<pair<string, LifeEngineFactory>> &registry()
+{
+    static vector<pair<string, LifeEngineFactory>> engines;
+    if (engines.empty())
+    {
+        engines.push_back(make_pair("sequential", createSequential));
+        engines.push_back(make_pair("dataflow", createDataflow));
+        engines.push_back(make_pair("parallel", createParallel));
+        engines.push_back(make_pair("parallel-packed", createParallelPacked));
+        engines.push_back(make_pair("parallel-rle", createParallelRLE));
+    }
+    return engines;
+}
+
+void registerLifeEngine(const string &name, LifeEngineFactory factory)
+{
+    vector<pair<string, LifeEngineFactory>> &engines = registry();
+    for (size_t i = 0; i < engines.size(); i++)
+        if (engines[i].first == name)
+        {
+            engines[i].second = factory;
+            return;
+        }
+    engines.push_back(make_pair(name, factory));
+}
+
+vector<string> lifeEngineNames()
+{
+    vector<string> names;
+    vector<pair<string, LifeEngineFactory>> &engines = registry();
+    for (size_t i = 0; i < engines.size(); i++)
+        names.push_back(engines[i].first);
+    return names;
+}
+
+Life *createLifeEngine(const LifeEngineConfig &config, MPI_Comm comm)
+{
+    vector<pair<string, LifeEngineFactory>> &engines = registry();
+    for (size_t i = 0; i < engines.size(); i++)
+        if (engines[i].first == config.engine)
+            return engines[i].second(config, comm);
+    return NULL;
+}
+
+Life *createLifeEngine(const string &name, MPI_Comm comm)
+{
+    return createLifeEngine(LifeEngineConfig(name), comm);
+}
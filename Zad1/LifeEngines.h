@@ -0,0 +1,46 @@
+/*
+ * LifeEngines.h
+ */
+
+#ifndef LIFEENGINES_H_
+#define LIFEENGINES_H_
+
+#include "HaloCodec.h"
+#include "Life.h"
+
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+// engine name plus the knobs the engines understand; a knob an engine has no
+// use for is ignored
+struct LifeEngineConfig
+{
+    std::string engine;
+    int threads;              // dataflow, 0 = all hardware threads
+    int tileSize;             // dataflow, 0 = engine default
+    HaloCodec::Encoding halo; // parallel
+
+    LifeEngineConfig(const std::string &engine = "", int threads = 0, int tileSize = 0,
+                     HaloCodec::Encoding halo = HaloCodec::RAW);
+    // one line, e.g. "dataflow threads=8 tile=64 halo=raw"
+    std::string describe() const;
+    // inverse of describe(); false if the engine name is missing
+    bool parse(const std::string &line);
+};
+
+// NULL if the engine cannot run on comm
+typedef Life *(*LifeEngineFactory)(const LifeEngineConfig &config, MPI_Comm comm);
+
+// the built-in engines are registered on first use:
+// "sequential" (single process only), "dataflow" (tile tasks, per tile halo
+// messages between processes), "parallel" and "parallel-packed" /
+// "parallel-rle" (parallel with compressed halos)
+void registerLifeEngine(const std::string &name, LifeEngineFactory factory);
+std::vector<std::string> lifeEngineNames();
+
+// NULL if the name is unknown or the engine cannot run on comm
+Life *createLifeEngine(const LifeEngineConfig &config, MPI_Comm comm = MPI_COMM_WORLD);
+Life *createLifeEngine(const std::string &name, MPI_Comm comm = MPI_COMM_WORLD);
+
+#endif /* LIFEENGINES_H_ */
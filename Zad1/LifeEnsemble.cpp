@@ -0,0 +1,145 @@
+/*
+ * LifeEnsemble.cpp
+ */
+
+#include "LifeEnsemble.h"
+#include "CycleDetector.h"
+#include "LifeSequentialImplementation.h"
+
+#include <chrono>
+#include <mpi.h>
+#include <thread>
+
+LifeEnsemble::LifeEnsemble(Rules *rules, int size, int boards, int threads)
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+    MPI_Comm_size(MPI_COMM_WORLD, &procSize_);
+    boards_ = boards;
+    for (int board = rank_; board < boards_; board += procSize_)
+    {
+        localBoards_.push_back(board);
+    }
+    if (threads <= 0)
+    {
+        unsigned hardware = std::thread::hardware_concurrency();
+        threads = hardware ? (int)hardware : 1;
+    }
+    // no more engines than boards, but at least one
+    if (threads > (int)localBoards_.size())
+    {
+        threads = localBoards_.empty() ? 1 : (int)localBoards_.size();
+    }
+    for (int thread = 0; thread < threads; thread++)
+    {
+        Life *life = new LifeSequentialImplementation();
+        life->setRules(rules);
+        life->setSize(size);
+        lives_.push_back(life);
+    }
+    init_ = NULL;
+    initArg_ = NULL;
+}
+
+LifeEnsemble::~LifeEnsemble()
+{
+    for (size_t i = 0; i < lives_.size(); i++)
+    {
+        delete lives_[i];
+    }
+}
+
+int LifeEnsemble::boards()
+{
+    return boards_;
+}
+
+int LifeEnsemble::threads()
+{
+    return (int)lives_.size();
+}
+
+bool LifeEnsemble::isLocal(int board)
+{
+    return board % procSize_ == rank_;
+}
+
+void LifeEnsemble::initialize(BoardInit init, void *arg)
+{
+    init_ = init;
+    initArg_ = arg;
+}
+
+void LifeEnsemble::worker(Life *life, std::atomic<int> *next, int steps, bool untilSteady, int history, double *rows)
+{
+    CycleDetector detector(history);
+    for (int i = (*next)++; i < (int)localBoards_.size(); i = (*next)++)
+    {
+        // the pool threads make no MPI calls, MPI_Wtime included
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        life->clear();
+        if (init_)
+        {
+            init_(life, localBoards_[i], initArg_);
+        }
+        int stepsDone = steps;
+        detector.reset();
+        life->beforeFirstStep();
+        if (untilSteady)
+        {
+            life->setHashing(true);
+            detector.push(life->stateHash());
+        }
+        for (int t = 0; t < steps; t++)
+        {
+            life->oneStep();
+            if (untilSteady && detector.push(life->stateHash()))
+            {
+                stepsDone = t + 1;
+                break;
+            }
+        }
+        life->afterLastStep();
+        life->setHashing(false);
+
+        double *row = &rows[5 * localBoards_[i]];
+        row[0] = life->numberOfLivingCells();
+        row[1] = life->averagePollution();
+        row[2] = stepsDone;
+        row[3] = detector.period();
+        row[4] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+std::vector<BoardStats> LifeEnsemble::run(int steps, bool untilSteady, int history)
+{
+    // one row per board: living cells, pollution, steps, period, seconds;
+    // rows of other ranks stay zero, so a single MPI_SUM gathers everything
+    std::vector<double> local(5 * boards_, 0.0);
+    std::atomic<int> next(0);
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < lives_.size(); i++)
+    {
+        pool.push_back(std::thread(&LifeEnsemble::worker, this, lives_[i], &next, steps, untilSteady, history,
+                                   local.data()));
+    }
+    worker(lives_[0], &next, steps, untilSteady, history, local.data());
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+        pool[i].join();
+    }
+
+    std::vector<double> global(5 * boards_, 0.0);
+    MPI_Reduce(local.data(), global.data(), 5 * boards_, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    std::vector<BoardStats> stats;
+    if (rank_ == 0)
+    {
+        for (int board = 0; board < boards_; board++)
+        {
+            double *row = &global[5 * board];
+            BoardStats s = {(long long)row[0], row[1], (int)row[2], (int)row[3], row[4]};
+            stats.push_back(s);
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,66 @@
+/*
+ * LifeEnsemble.h
+ */
+
+#ifndef LIFEENSEMBLE_H_
+#define LIFEENSEMBLE_H_
+
+#include "Life.h"
+#include "Rules.h"
+
+#include <atomic>
+#include <vector>
+
+struct BoardStats
+{
+    long long livingCells;
+    double averagePollution;
+    int steps;      // generations actually computed
+    int period;     // steady-state period, 0 if none was detected
+    double seconds; // wall time spent on this board
+};
+
+// Many small, independent boards in one process. Boards are dealt round-robin
+// to the MPI ranks and the statistics are reduced to rank 0. Within a rank a
+// pool of threads claims the boards one at a time; every thread owns a single
+// sequential engine and re-initializes it for each board it takes, so memory
+// grows with the thread count, not with the number of boards.
+class LifeEnsemble
+{
+public:
+    typedef void (*BoardInit)(Life *life, int board, void *arg);
+
+private:
+    int rank_;
+    int procSize_;
+    int boards_;
+    std::vector<int> localBoards_; // global indices of the boards on this rank
+    std::vector<Life *> lives_;    // one engine per thread, lives_[0] for the caller
+    BoardInit init_;
+    void *initArg_;
+
+    // steps local boards claimed from next until none are left; each writes
+    // its row of rows (5 values, indexed by the global board number)
+    void worker(Life *life, std::atomic<int> *next, int steps, bool untilSteady, int history, double *rows);
+
+public:
+    // threads <= 0 takes all hardware threads; with several ranks on a node
+    // pass the cores per rank instead
+    LifeEnsemble(Rules *rules, int size, int boards, int threads = 0);
+    virtual ~LifeEnsemble();
+
+    int boards();
+    int threads(); // engines, and so threads, on this rank
+    bool isLocal(int board);
+
+    // init fills a cleared board; it is called just before the board is
+    // stepped, from any of the threads, so it must not share mutable state
+    void initialize(BoardInit init, void *arg);
+
+    // starts every board from init, advances it by steps generations (or until
+    // it is steady) and returns the statistics of all boards on rank 0, empty
+    // elsewhere
+    std::vector<BoardStats> run(int steps, bool untilSteady = false, int history = 64);
+};
+
+#endif /* LIFEENSEMBLE_H_ */
@@ -0,0 +1,226 @@
+/*
+ * LifeOutOfCore.cpp
+ */
+
+#include "LifeOutOfCore.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+LifeOutOfCore::LifeOutOfCore()
+{
+    rules_ = 0;
+    size_ = size_1_ = 0;
+    bandRows_ = 0;
+    fd_ = -1;
+    map_ = 0;
+    planeBytes_ = 0;
+    pageSize_ = sysconf(_SC_PAGESIZE);
+    generation_ = 0;
+}
+
+LifeOutOfCore::~LifeOutOfCore()
+{
+    if (map_)
+    {
+        munmap(map_, 4 * planeBytes_);
+    }
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+}
+
+void LifeOutOfCore::setRules(Rules *rules)
+{
+    rules_ = rules;
+}
+
+bool LifeOutOfCore::setSize(long long size, const char *fileName, long long bandRows)
+{
+    if (rules_ && rules_->getMaxPollution() > 255)
+    {
+        cerr << "LifeOutOfCore: pollution does not fit in a byte" << endl;
+        return false;
+    }
+    size_ = size;
+    size_1_ = size - 1;
+    bandRows_ = bandRows < 1 ? 1 : bandRows;
+    planeBytes_ = size * size;
+    generation_ = 0;
+
+    fd_ = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    // a fresh sparse file reads as zeros: dead cells, no pollution, dead frame
+    if (fd_ < 0 || ftruncate(fd_, 4 * planeBytes_) != 0)
+    {
+        cerr << "LifeOutOfCore: cannot create " << fileName << endl;
+        return false;
+    }
+    void *map = mmap(0, 4 * planeBytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED)
+    {
+        cerr << "LifeOutOfCore: cannot map " << fileName << endl;
+        return false;
+    }
+    map_ = (unsigned char *)map;
+    madvise(map_, 4 * planeBytes_, MADV_SEQUENTIAL);
+    return true;
+}
+
+unsigned char *LifeOutOfCore::cellsPlane(int parity)
+{
+    return map_ + 2 * parity * planeBytes_;
+}
+
+unsigned char *LifeOutOfCore::pollutionPlane(int parity)
+{
+    return map_ + (2 * parity + 1) * planeBytes_;
+}
+
+void LifeOutOfCore::prefetch(unsigned char *plane, long long firstRow, long long lastRow)
+{
+    if (lastRow > size_)
+    {
+        lastRow = size_;
+    }
+    if (firstRow >= lastRow)
+    {
+        return;
+    }
+    long long begin = ((long long)(plane - map_) + firstRow * size_) / pageSize_ * pageSize_;
+    long long end = (long long)(plane - map_) + lastRow * size_;
+    madvise(map_ + begin, end - begin, MADV_WILLNEED);
+}
+
+void LifeOutOfCore::release(int plane, long long lastRow)
+{
+    // only whole pages below lastRow are dropped; the partial page is
+    // released together with the next band
+    long long end = (plane * planeBytes_ + lastRow * size_) / pageSize_ * pageSize_;
+    if (end <= released_[plane])
+    {
+        return;
+    }
+    msync(map_ + released_[plane], end - released_[plane], MS_ASYNC); // start writeback first
+    madvise(map_ + released_[plane], end - released_[plane], MADV_DONTNEED);
+    released_[plane] = end;
+}
+
+void LifeOutOfCore::resetReleased()
+{
+    for (int plane = 0; plane < 4; plane++)
+    {
+        released_[plane] = (plane * planeBytes_ + pageSize_ - 1) / pageSize_ * pageSize_;
+    }
+}
+
+void LifeOutOfCore::bringToLife(long long row, long long col)
+{
+    cellsPlane(generation_ & 1)[row * size_ + col] = 1;
+}
+
+int LifeOutOfCore::getCellState(long long row, long long col)
+{
+    return cellsPlane(generation_ & 1)[row * size_ + col];
+}
+
+int LifeOutOfCore::getPollution(long long row, long long col)
+{
+    return pollutionPlane(generation_ & 1)[row * size_ + col];
+}
+
+long long LifeOutOfCore::getSize()
+{
+    return size_;
+}
+
+void LifeOutOfCore::stepRow(long long row, const unsigned char *c, const unsigned char *p, unsigned char *cn,
+                            unsigned char *pn)
+{
+    const unsigned char *cUp = c + (row - 1) * size_;
+    const unsigned char *cRow = c + row * size_;
+    const unsigned char *cDown = c + (row + 1) * size_;
+    const unsigned char *pUp = p + (row - 1) * size_;
+    const unsigned char *pRow = p + row * size_;
+    const unsigned char *pDown = p + (row + 1) * size_;
+    unsigned char *cOut = cn + row * size_;
+    unsigned char *pOut = pn + row * size_;
+    int currentState, currentPollution, liveN;
+    for (long long col = 1; col < size_1_; col++)
+    {
+        currentState = cRow[col];
+        currentPollution = pRow[col];
+        liveN = cUp[col - 1] + cUp[col] + cUp[col + 1] + cRow[col - 1] + cRow[col + 1] + cDown[col - 1] + cDown[col] +
+                cDown[col + 1];
+        cOut[col] = (unsigned char)rules_->cellNextState(currentState, liveN, currentPollution);
+        pOut[col] = (unsigned char)rules_->nextPollution(currentState, currentPollution,
+                                                         pDown[col] + pUp[col] + pRow[col - 1] + pRow[col + 1],
+                                                         pUp[col - 1] + pUp[col + 1] + pDown[col - 1] + pDown[col + 1]);
+    }
+}
+
+void LifeOutOfCore::oneStep()
+{
+    int parity = generation_ & 1;
+    unsigned char *c = cellsPlane(parity);
+    unsigned char *p = pollutionPlane(parity);
+    unsigned char *cn = cellsPlane(parity ^ 1);
+    unsigned char *pn = pollutionPlane(parity ^ 1);
+
+    resetReleased();
+    for (long long firstRow = 1; firstRow < size_1_; firstRow += bandRows_)
+    {
+        long long lastRow = firstRow + bandRows_ < size_1_ ? firstRow + bandRows_ : size_1_;
+
+        // the next band (and its lower neighbour row) is read next
+        prefetch(c, lastRow, lastRow + bandRows_ + 1);
+        prefetch(p, lastRow, lastRow + bandRows_ + 1);
+
+        for (long long row = firstRow; row < lastRow; row++)
+        {
+            stepRow(row, c, p, cn, pn);
+        }
+
+        // row lastRow - 1 is still the upper neighbour of the next band
+        release(2 * parity, lastRow - 1);
+        release(2 * parity + 1, lastRow - 1);
+        release(2 * (parity ^ 1), lastRow);
+        release(2 * (parity ^ 1) + 1, lastRow);
+    }
+    generation_++;
+}
+
+long long LifeOutOfCore::sumPlane(int plane)
+{
+    const unsigned char *data = map_ + plane * planeBytes_;
+    long long sum = 0;
+    resetReleased();
+    for (long long firstRow = 1; firstRow < size_1_; firstRow += bandRows_)
+    {
+        long long lastRow = firstRow + bandRows_ < size_1_ ? firstRow + bandRows_ : size_1_;
+        for (long long row = firstRow; row < lastRow; row++)
+        {
+            const unsigned char *r = data + row * size_;
+            for (long long col = 1; col < size_1_; col++)
+            {
+                sum += r[col];
+            }
+        }
+        release(plane, lastRow);
+    }
+    return sum;
+}
+
+long long LifeOutOfCore::numberOfLivingCells()
+{
+    return sumPlane(2 * (generation_ & 1));
+}
+
+double LifeOutOfCore::averagePollution()
+{
+    return (double)sumPlane(2 * (generation_ & 1) + 1) / ((double)size_1_ * size_1_) / rules_->getMaxPollution();
+}
@@ -0,0 +1,57 @@
+/*
+ * LifeOutOfCore.h
+ */
+
+#ifndef LIFEOUTOFCORE_H_
+#define LIFEOUTOFCORE_H_
+
+#include "Rules.h"
+
+// Life for boards larger than RAM. Both generations live in one memory-mapped
+// file as byte planes (cells and pollution, so getMaxPollution() must fit in a
+// byte), indexed with 64-bit arithmetic. oneStep() streams the board in bands
+// of rows: the next band is prefetched with MADV_WILLNEED and the bands left
+// behind are released with MADV_DONTNEED, so the resident set stays around a
+// few bands no matter how large the board is.
+class LifeOutOfCore
+{
+private:
+    Rules *rules_;
+    long long size_;
+    long long size_1_;
+    long long bandRows_;     // rows per streamed band
+    int fd_;
+    unsigned char *map_;     // whole file: [cells 0][pollution 0][cells 1][pollution 1]
+    long long planeBytes_;   // size_ * size_
+    long long pageSize_;
+    int generation_;         // parity selects the current planes
+    long long released_[4];  // per plane: bytes before this offset were released
+
+    unsigned char *cellsPlane(int parity);
+    unsigned char *pollutionPlane(int parity);
+    void prefetch(unsigned char *plane, long long firstRow, long long lastRow);
+    void release(int plane, long long lastRow);
+    void resetReleased();
+    void stepRow(long long row, const unsigned char *c, const unsigned char *p, unsigned char *cn, unsigned char *pn);
+    long long sumPlane(int plane);
+
+public:
+    LifeOutOfCore();
+    virtual ~LifeOutOfCore();
+
+    void setRules(Rules *rules);
+    // creates (or truncates) fileName to hold a size x size board;
+    // false if the file cannot be created or mapped
+    bool setSize(long long size, const char *fileName, long long bandRows = 256);
+
+    void bringToLife(long long row, long long col);
+    int getCellState(long long row, long long col);
+    int getPollution(long long row, long long col);
+    long long getSize();
+
+    void oneStep();
+    long long numberOfLivingCells();
+    double averagePollution();
+};
+
+#endif /* LIFEOUTOFCORE_H_ */
@@ -1,43 +1,153 @@
 // LifeParallelImplementation.cpp
 #include "LifeParallelImplementation.h"
+#include "LifeTimers.h"
 #include <mpi.h>
 
-LifeParallelImplementation::LifeParallelImplementation()
+LifeParallelImplementation::LifeParallelImplementation(MPI_Comm comm)
 {
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
-    MPI_Comm_size(MPI_COMM_WORLD, &procSize_);
+    comm_ = comm;
+    MPI_Comm_rank(comm_, &rank_);
+    MPI_Comm_size(comm_, &procSize_);
 }
 
 LifeParallelImplementation::~LifeParallelImplementation()
 {
+    delete codec_;
+    delete[] haloBuffers_;
+}
+
+void LifeParallelImplementation::setHaloEncoding(HaloCodec::Encoding encoding)
+{
+    haloEncoding_ = encoding;
+    delete codec_;
+    delete[] haloBuffers_;
+    codec_ = nullptr;
+    haloBuffers_ = nullptr;
+}
+
+long long LifeParallelImplementation::haloBytesSent()
+{
+    return haloBytesSent_;
+}
+
+void LifeParallelImplementation::neighbours(int &up, int &down)
+{
+    // neighbours above and below; on a torus the first and last process are
+    // neighbours too, otherwise MPI_PROC_NULL turns their transfers into no-ops
+    up = rank_ - 1;
+    down = rank_ + 1;
+    if (boundary == PERIODIC)
+    {
+        up = (up + procSize_) % procSize_;
+        down = down % procSize_;
+    }
+    else
+    {
+        up = up < 0 ? MPI_PROC_NULL : up;
+        down = down == procSize_ ? MPI_PROC_NULL : down;
+    }
 }
 
 void LifeParallelImplementation::exchangeBorderRowsInfo()
 {
-    // send the first row to the previous process
-    if (rank_ != 0)
+    if (haloEncoding_ != HaloCodec::RAW && rules->getMaxPollution() <= 255)
     {
-        MPI_Send(cells[firstRow_], size, MPI_INT, rank_ - 1, 0, MPI_COMM_WORLD);
-        MPI_Send(pollution[firstRow_], size, MPI_INT, rank_ - 1, 0, MPI_COMM_WORLD);
+        exchangeEncodedBorderRows();
+        return;
     }
-    // receive the first row from the next process
-    if (rank_ != procSize_ - 1)
+    int up, down;
+    neighbours(up, down);
+
+    // tags tell the direction apart when up == down (two processes on a torus)
+    MPI_Request requests[8];
+    if (timers)
     {
-        MPI_Recv(cells[lastRow_], size, MPI_INT, rank_ + 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        MPI_Recv(pollution[lastRow_], size, MPI_INT, rank_ + 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        timers->start(LifeTimers::HALO_POST);
     }
-    // send the last row to the next process
-    if (rank_ != procSize_ - 1)
+    // receive the first row of the next process and the last row of the previous one
+    MPI_Irecv(cells[lastRow_], size, MPI_INT, down, 0, comm_, &requests[0]);
+    MPI_Irecv(pollution[lastRow_], size, MPI_INT, down, 1, comm_, &requests[1]);
+    MPI_Irecv(cells[firstRow_ - 1], size, MPI_INT, up, 2, comm_, &requests[2]);
+    MPI_Irecv(pollution[firstRow_ - 1], size, MPI_INT, up, 3, comm_, &requests[3]);
+    // send the first row to the previous process and the last row to the next one
+    MPI_Isend(cells[firstRow_], size, MPI_INT, up, 0, comm_, &requests[4]);
+    MPI_Isend(pollution[firstRow_], size, MPI_INT, up, 1, comm_, &requests[5]);
+    MPI_Isend(cells[lastRow_ - 1], size, MPI_INT, down, 2, comm_, &requests[6]);
+    MPI_Isend(pollution[lastRow_ - 1], size, MPI_INT, down, 3, comm_, &requests[7]);
+    if (timers)
     {
-        MPI_Send(cells[lastRow_ - 1], size, MPI_INT, rank_ + 1, 0, MPI_COMM_WORLD);
-        MPI_Send(pollution[lastRow_ - 1], size, MPI_INT, rank_ + 1, 0, MPI_COMM_WORLD);
+        timers->stop(LifeTimers::HALO_POST);
+        timers->start(LifeTimers::HALO_WAIT);
     }
-    // receive the last row from the previous process
-    if (rank_ != 0)
+    MPI_Waitall(8, requests, MPI_STATUSES_IGNORE);
+    if (timers)
     {
-        MPI_Recv(cells[firstRow_ - 1], size, MPI_INT, rank_ - 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        MPI_Recv(pollution[firstRow_ - 1], size, MPI_INT, rank_ - 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        timers->stop(LifeTimers::HALO_WAIT);
     }
+    haloBytesSent_ += (up != MPI_PROC_NULL) * 2 * size * sizeof(int) + (down != MPI_PROC_NULL) * 2 * size * sizeof(int);
+}
+
+void LifeParallelImplementation::exchangeEncodedBorderRows()
+{
+    int up, down;
+    neighbours(up, down);
+    if (!codec_)
+    {
+        codec_ = new HaloCodec(haloEncoding_, size);
+        haloBuffers_ = new unsigned char[4 * codec_->capacity()];
+    }
+    int capacity = codec_->capacity();
+    unsigned char *sendUp = haloBuffers_;
+    unsigned char *sendDown = haloBuffers_ + capacity;
+    unsigned char *recvUp = haloBuffers_ + 2 * capacity;
+    unsigned char *recvDown = haloBuffers_ + 3 * capacity;
+
+    // cells and pollution of a row go out as one message
+    if (timers)
+    {
+        timers->start(LifeTimers::HALO_PACK);
+    }
+    int upBytes = codec_->encode(cells[firstRow_], pollution[firstRow_], sendUp);
+    int downBytes = codec_->encode(cells[lastRow_ - 1], pollution[lastRow_ - 1], sendDown);
+    if (timers)
+    {
+        timers->stop(LifeTimers::HALO_PACK);
+        timers->start(LifeTimers::HALO_POST);
+    }
+    MPI_Request requests[4];
+    MPI_Status statuses[4];
+    MPI_Irecv(recvDown, capacity, MPI_BYTE, down, 0, comm_, &requests[0]);
+    MPI_Irecv(recvUp, capacity, MPI_BYTE, up, 1, comm_, &requests[1]);
+    MPI_Isend(sendUp, upBytes, MPI_BYTE, up, 0, comm_, &requests[2]);
+    MPI_Isend(sendDown, downBytes, MPI_BYTE, down, 1, comm_, &requests[3]);
+    if (timers)
+    {
+        timers->stop(LifeTimers::HALO_POST);
+        timers->start(LifeTimers::HALO_WAIT);
+    }
+    MPI_Waitall(4, requests, statuses);
+    if (timers)
+    {
+        timers->stop(LifeTimers::HALO_WAIT);
+        timers->start(LifeTimers::HALO_PACK);
+    }
+    // nothing arrives from MPI_PROC_NULL, the frame row stays as it is
+    int bytes;
+    if (down != MPI_PROC_NULL)
+    {
+        MPI_Get_count(&statuses[0], MPI_BYTE, &bytes);
+        codec_->decode(recvDown, bytes, cells[lastRow_], pollution[lastRow_]);
+    }
+    if (up != MPI_PROC_NULL)
+    {
+        MPI_Get_count(&statuses[1], MPI_BYTE, &bytes);
+        codec_->decode(recvUp, bytes, cells[firstRow_ - 1], pollution[firstRow_ - 1]);
+    }
+    if (timers)
+    {
+        timers->stop(LifeTimers::HALO_PACK);
+    }
+    haloBytesSent_ += (up != MPI_PROC_NULL) * upBytes + (down != MPI_PROC_NULL) * downBytes;
 }
 
 void LifeParallelImplementation::realStep()
@@ -46,28 +156,56 @@ void LifeParallelImplementation::realStep()
     {
         exchangeBorderRowsInfo(); // exchange borders before updating the cells
     }
+    if (boundary == PERIODIC)
+    {
+        if (timers)
+        {
+            timers->start(LifeTimers::HALO_FILL);
+        }
+        if (procSize_ == 1)
+        {
+            fillRowHalo();
+        }
+        fillColumnHalo(firstRow_ - 1, lastRow_ + 1);
+        if (timers)
+        {
+            timers->stop(LifeTimers::HALO_FILL);
+        }
+    }
 
-    int currentState, currentPollution;
+    if (timers)
+    {
+        timers->start(LifeTimers::COMPUTE);
+    }
+    if (hashing)
+    {
+        clearTileHashes();
+    }
     for (int row = firstRow_; row < lastRow_; row++)
-        for (int col = 1; col < size_1; col++)
+    {
+        rowKernel(&rowRules, cells, pollution, cellsNext, pollutionNext, row, 1, size_1);
+        if (hashing)
         {
-            currentState = cells[row][col];
-            currentPollution = pollution[row][col];
-            cellsNext[row][col] = rules->cellNextState(currentState, liveNeighbours(row, col),
-                                                       currentPollution);
-            pollutionNext[row][col] =
-                rules->nextPollution(currentState, currentPollution, pollution[row + 1][col] + pollution[row - 1][col] + pollution[row][col - 1] + pollution[row][col + 1],
-                                     pollution[row - 1][col - 1] + pollution[row - 1][col + 1] + pollution[row + 1][col - 1] + pollution[row + 1][col + 1]);
+            hashRow(cellsNext, pollutionNext, row);
         }
+    }
+    if (timers)
+    {
+        timers->stop(LifeTimers::COMPUTE);
+    }
 }
 
 void LifeParallelImplementation::oneStep()
 {
     realStep();
     swapTables();
+    if (timers)
+    {
+        timers->nextStep();
+    }
 }
 
-int LifeParallelImplementation::numberOfLivingCells()
+long long LifeParallelImplementation::numberOfLivingCells()
 {
     if (!afterLastStep_)
     {
@@ -76,6 +214,23 @@ int LifeParallelImplementation::numberOfLivingCells()
     return sumTable(cells);
 }
 
+unsigned long long LifeParallelImplementation::stateHash()
+{
+    unsigned long long local = localStateHash();
+    unsigned long long global = local;
+    if (procSize_ > 1)
+    {
+        MPI_Allreduce(&local, &global, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm_);
+    }
+    return global;
+}
+
+void LifeParallelImplementation::globalTileHashes(unsigned long long *hashes)
+{
+    // tiles cut by a process boundary hold partial sums on both processes
+    MPI_Allreduce(tileHash, hashes, hashTilesPerSide * hashTilesPerSide, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm_);
+}
+
 double LifeParallelImplementation::averagePollution()
 {
     if (!afterLastStep_)
@@ -85,57 +240,79 @@ double LifeParallelImplementation::averagePollution()
     return (double)sumTable(pollution) / size_1_squared / rules->getMaxPollution();
 }
 
+void LifeParallelImplementation::rowRange(int procNum, int &firstRow, int &lastRow)
+{
+    // split the board into equal parts, the last process takes the remainder
+    int rowsPerProcess = size / procSize_;
+    firstRow = procNum * rowsPerProcess;
+    lastRow = firstRow + rowsPerProcess;
+    if (procNum == 0)
+    {
+        firstRow = 1;
+    }
+    if (procNum == procSize_ - 1)
+    {
+        lastRow = size_1;
+    }
+}
+
+void LifeParallelImplementation::setSize(int size)
+{
+    Life::setSize(size);
+    rowRange(rank_, firstRow_, lastRow_);
+}
+
+int LifeParallelImplementation::firstOwnedRow()
+{
+    return firstRow_;
+}
+
+int LifeParallelImplementation::lastOwnedRow()
+{
+    return lastRow_;
+}
+
+void LifeParallelImplementation::setDistributedInit(bool distributed)
+{
+    distributedInit_ = distributed;
+}
+
 void LifeParallelImplementation::beforeFirstStep()
 {
-    if (procSize_ > 1)
+    if (procSize_ == 1 || distributedInit_)
     {
-        if (rank_ == 0)
+        return; // every process already holds its own rows
+    }
+    if (timers)
+    {
+        timers->start(LifeTimers::DISTRIBUTE);
+    }
+    if (rank_ == 0)
+    {
+        // send the initial rows to all other processes
+        int firstRow, lastRow;
+        for (int procNum = 1; procNum < procSize_; procNum++)
         {
-            // split the board into equal parts for each process
-            int rowsPerProcess = size / procSize_;
-            int rowsLeft = size % procSize_;
-            firstRow_ = 0;
-            lastRow_ = 0;
-            for (int procNum = 0; procNum < procSize_; procNum++)
+            rowRange(procNum, firstRow, lastRow);
+            for (int j = firstRow; j < lastRow; j++)
             {
-                firstRow_ = lastRow_;
-                lastRow_ = firstRow_ + rowsPerProcess;
-                if (procNum == procSize_ - 1)
-                {
-                    lastRow_ += rowsLeft - 1;
-                }
-                if (procNum == 0)
-                {
-                    continue;
-                }
-                // send the information to all other processes
-                MPI_Send(&firstRow_, 1, MPI_INT, procNum, 0, MPI_COMM_WORLD);
-                MPI_Send(&lastRow_, 1, MPI_INT, procNum, 0, MPI_COMM_WORLD);
-                for (int j = firstRow_; j < lastRow_; j++)
-                {
-                    MPI_Send(cells[j], size, MPI_INT, procNum, 0, MPI_COMM_WORLD);
-                    MPI_Send(pollution[j], size, MPI_INT, procNum, 0, MPI_COMM_WORLD);
-                }
+                MPI_Send(cells[j], size, MPI_INT, procNum, 0, comm_);
+                MPI_Send(pollution[j], size, MPI_INT, procNum, 0, comm_);
             }
-            firstRow_ = 1;
-            lastRow_ = rowsPerProcess;
         }
-        else
+    }
+    else
+    {
+        // receive all the information from the root process
+        for (int i = firstRow_; i < lastRow_; i++)
         {
-            // receive all the information from the root process
-            MPI_Recv(&firstRow_, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            MPI_Recv(&lastRow_, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            for (int i = firstRow_; i < lastRow_; i++)
-            {
-                MPI_Recv(cells[i], size, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                MPI_Recv(pollution[i], size, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            }
+            MPI_Recv(cells[i], size, MPI_INT, 0, 0, comm_, MPI_STATUS_IGNORE);
+            MPI_Recv(pollution[i], size, MPI_INT, 0, 0, comm_, MPI_STATUS_IGNORE);
         }
     }
-    else
+    if (timers)
     {
-        firstRow_ = 1;
-        lastRow_ = size_1;
+        timers->stop(LifeTimers::DISTRIBUTE);
     }
 }
 
@@ -143,18 +320,22 @@ void LifeParallelImplementation::afterLastStep()
 {
     if (procSize_ > 1)
     {
+        if (timers)
+        {
+            timers->start(LifeTimers::GATHER);
+        }
         // send the table from all processes to the root process
         if (rank_ == 0)
         {
             // receive the table from all other processes
+            int firstRow, lastRow;
             for (int procNum = 1; procNum < procSize_; procNum++)
             {
-                MPI_Recv(&firstRow_, 1, MPI_INT, procNum, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                MPI_Recv(&lastRow_, 1, MPI_INT, procNum, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                for (int i = firstRow_; i < lastRow_; i++)
+                rowRange(procNum, firstRow, lastRow);
+                for (int i = firstRow; i < lastRow; i++)
                 {
-                    MPI_Recv(cells[i], size, MPI_INT, procNum, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    MPI_Recv(pollution[i], size, MPI_INT, procNum, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                    MPI_Recv(cells[i], size, MPI_INT, procNum, 0, comm_, MPI_STATUS_IGNORE);
+                    MPI_Recv(pollution[i], size, MPI_INT, procNum, 0, comm_, MPI_STATUS_IGNORE);
                 }
             }
             afterLastStep_ = true;
@@ -162,13 +343,15 @@ void LifeParallelImplementation::afterLastStep()
         else
         {
             // send the table from all processes to the root process
-            MPI_Send(&firstRow_, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
-            MPI_Send(&lastRow_, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
             for (int i = firstRow_; i < lastRow_; i++)
             {
-                MPI_Send(cells[i], size, MPI_INT, 0, 0, MPI_COMM_WORLD);
-                MPI_Send(pollution[i], size, MPI_INT, 0, 0, MPI_COMM_WORLD);
+                MPI_Send(cells[i], size, MPI_INT, 0, 0, comm_);
+                MPI_Send(pollution[i], size, MPI_INT, 0, 0, comm_);
             }
         }
+        if (timers)
+        {
+            timers->stop(LifeTimers::GATHER);
+        }
     }
 }
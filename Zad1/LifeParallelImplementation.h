@@ -2,25 +2,51 @@
 #ifndef LIFEPARALLELIMPLEMENTATION_H_
 #define LIFEPARALLELIMPLEMENTATION_H_
 
+#include "HaloCodec.h"
 #include "Life.h"
 
+#include <mpi.h>
+
 class LifeParallelImplementation : public Life
 {
-private:
-    int rank_;                   // rank of the current process
-    int procSize_;               // total number of processes
-    int firstRow_;               // index of the first row in the current process
-    int lastRow_;                // index of the last row in the current process
-    bool afterLastStep_ = false; // true if the last step has been performed
+protected:
+    MPI_Comm comm_;                // processes sharing this board
+    int rank_;                     // rank of the current process
+    int procSize_;                 // total number of processes
+    int firstRow_;                 // index of the first row in the current process
+    int lastRow_;                  // index of the last row in the current process
+    long long haloBytesSent_ = 0;  // halo bytes this process put on the wire
 
+    void neighbours(int &up, int &down);
     void exchangeBorderRowsInfo();
 
+private:
+    bool afterLastStep_ = false;   // true if the last step has been performed
+    bool distributedInit_ = false; // true if every process initialized its own rows
+    HaloCodec::Encoding haloEncoding_ = HaloCodec::RAW;
+    HaloCodec *codec_ = nullptr;   // created on the first encoded exchange
+    // send up, send down, receive up, receive down; codec_->capacity() each
+    unsigned char *haloBuffers_ = nullptr;
+
+    void rowRange(int procNum, int &firstRow, int &lastRow);
+    void exchangeEncodedBorderRows();
+
 public:
-    LifeParallelImplementation();
+    LifeParallelImplementation(MPI_Comm comm = MPI_COMM_WORLD);
     virtual ~LifeParallelImplementation();
 
-    int numberOfLivingCells();
+    void setSize(int size) override;
+    int firstOwnedRow() override;
+    int lastOwnedRow() override;
+    void setDistributedInit(bool distributed) override;
+    // falls back to RAW when the pollution does not fit in a byte
+    void setHaloEncoding(HaloCodec::Encoding encoding);
+    long long haloBytesSent();
+
+    long long numberOfLivingCells();
     double averagePollution();
+    unsigned long long stateHash() override;
+    void globalTileHashes(unsigned long long *hashes) override;
     void oneStep() override;
     void realStep() override;
     void beforeFirstStep() override;
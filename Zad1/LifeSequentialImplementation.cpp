@@ -4,6 +4,7 @@
  */
 
 #include "LifeSequentialImplementation.h"
+#include "LifeTimers.h"
 #include <stdlib.h>
 
 LifeSequentialImplementation::LifeSequentialImplementation()
@@ -12,27 +13,38 @@ LifeSequentialImplementation::LifeSequentialImplementation()
 
 void LifeSequentialImplementation::realStep()
 {
-	int currentState, currentPollution;
+	if (boundary == PERIODIC)
+	{
+		if (timers)
+			timers->start(LifeTimers::HALO_FILL);
+		fillRowHalo();
+		fillColumnHalo(0, size);
+		if (timers)
+			timers->stop(LifeTimers::HALO_FILL);
+	}
+	if (timers)
+		timers->start(LifeTimers::COMPUTE);
+	if (hashing)
+		clearTileHashes();
 	for (int row = 1; row < size_1; row++)
-		for (int col = 1; col < size_1; col++)
-		{
-			currentState = cells[row][col];
-			currentPollution = pollution[row][col];
-			cellsNext[row][col] = rules->cellNextState(currentState, liveNeighbours(row, col),
-													   currentPollution);
-			pollutionNext[row][col] =
-				rules->nextPollution(currentState, currentPollution, pollution[row + 1][col] + pollution[row - 1][col] + pollution[row][col - 1] + pollution[row][col + 1],
-									 pollution[row - 1][col - 1] + pollution[row - 1][col + 1] + pollution[row + 1][col - 1] + pollution[row + 1][col + 1]);
-		}
+	{
+		rowKernel(&rowRules, cells, pollution, cellsNext, pollutionNext, row, 1, size_1);
+		if (hashing)
+			hashRow(cellsNext, pollutionNext, row);
+	}
+	if (timers)
+		timers->stop(LifeTimers::COMPUTE);
 }
 
 void LifeSequentialImplementation::oneStep()
 {
 	realStep();
 	swapTables();
+	if (timers)
+		timers->nextStep();
 }
 
-int LifeSequentialImplementation::numberOfLivingCells() {
+long long LifeSequentialImplementation::numberOfLivingCells() {
 	return sumTable( cells );
 }
 
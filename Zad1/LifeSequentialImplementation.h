@@ -12,7 +12,7 @@ protected:
 	void realStep();
 public:
 	LifeSequentialImplementation();
-	int numberOfLivingCells();
+	long long numberOfLivingCells();
 	double averagePollution();
 	void oneStep();
 };
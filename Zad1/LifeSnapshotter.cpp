@@ -0,0 +1,129 @@
+/*
+ * LifeSnapshotter.cpp
+ */
+
+#include "LifeSnapshotter.h"
+#include "Alloc.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+LifeSnapshotter::LifeSnapshotter(int size, int spares, Sink sink, void *arg)
+{
+    size_ = size;
+    sink_ = sink;
+    arg_ = arg;
+    stop_ = false;
+    snapshots_ = 0;
+    stallSeconds_ = 0.0;
+    for (int i = 0; i < spares; i++)
+        spares_.push_back(make_pair(tableAlloc(size), tableAlloc(size)));
+    writer_ = thread(&LifeSnapshotter::drain, this);
+}
+
+// tables the engine still holds are the engine's to keep, only the pool is freed
+LifeSnapshotter::~LifeSnapshotter()
+{
+    flush();
+    {
+        lock_guard<mutex> guard(lock_);
+        stop_ = true;
+    }
+    changed_.notify_all();
+    writer_.join();
+    for (size_t i = 0; i < spares_.size(); i++)
+    {
+        tableFree(spares_[i].first, size_);
+        tableFree(spares_[i].second, size_);
+    }
+}
+
+void LifeSnapshotter::submit(const View &view)
+{
+    Pending entry = {view, false};
+    {
+        lock_guard<mutex> guard(lock_);
+        pending_.push_back(entry);
+        snapshots_++;
+    }
+    changed_.notify_all();
+}
+
+void LifeSnapshotter::drain()
+{
+    unique_lock<mutex> guard(lock_);
+    for (;;)
+    {
+        changed_.wait(guard, [&] { return stop_ || !pending_.empty(); });
+        if (pending_.empty())
+            return; // stop_ with nothing left
+        View view = pending_.front().view;
+        guard.unlock();
+        sink_(view, arg_);
+        guard.lock();
+        if (pending_.front().owned)
+            spares_.push_back(make_pair(view.cells, view.pollution));
+        pending_.pop_front();
+        changed_.notify_all();
+    }
+}
+
+bool LifeSnapshotter::release(int **cells, int **pollution)
+{
+    lock_guard<mutex> guard(lock_);
+    for (size_t i = 0; i < pending_.size(); i++)
+        if (pending_[i].view.cells == cells && pending_[i].view.pollution == pollution)
+        {
+            pending_[i].owned = true;
+            return true;
+        }
+    return false; // already drained
+}
+
+void LifeSnapshotter::takeSpare(int **&cells, int **&pollution)
+{
+    unique_lock<mutex> guard(lock_);
+    if (spares_.empty())
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        changed_.wait(guard, [&] { return !spares_.empty(); });
+        stallSeconds_ += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    cells = spares_.back().first;
+    pollution = spares_.back().second;
+    spares_.pop_back();
+}
+
+void LifeSnapshotter::flush()
+{
+    unique_lock<mutex> guard(lock_);
+    changed_.wait(guard, [&] { return pending_.empty(); });
+}
+
+long long LifeSnapshotter::snapshots()
+{
+    lock_guard<mutex> guard(lock_);
+    return snapshots_;
+}
+
+double LifeSnapshotter::stallSeconds()
+{
+    lock_guard<mutex> guard(lock_);
+    return stallSeconds_;
+}
+
+void LifeSnapshotter::writeFile(const View &view, void *arg)
+{
+    FileSinkArg *file = (FileSinkArg *)arg;
+    ostringstream name;
+    name << file->prefix << "." << view.generation << "." << file->rank;
+    ofstream out(name.str().c_str(), ios::binary);
+    out << view.size << " " << view.firstRow << " " << view.lastRow << " " << view.generation << "\n";
+    for (int row = view.firstRow; row < view.lastRow; row++)
+        out.write((const char *)(view.cells[row] + 1), (view.size - 2) * sizeof(int));
+    for (int row = view.firstRow; row < view.lastRow; row++)
+        out.write((const char *)(view.pollution[row] + 1), (view.size - 2) * sizeof(int));
+}
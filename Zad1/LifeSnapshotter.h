@@ -0,0 +1,88 @@
+/*
+ * LifeSnapshotter.h
+ */
+
+#ifndef LIFESNAPSHOTTER_H_
+#define LIFESNAPSHOTTER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Drains board snapshots on a background thread while the engine keeps
+// stepping. Life::snapshot() hands over a read-only view of the current
+// tables without copying them; when the engine is about to overwrite those
+// tables (the swap after the next step) and the view is still being
+// drained, the tables are kept by the snapshotter and the engine continues
+// with a spare pair from the pool. Drained tables return to the pool. When
+// the pool is empty the engine blocks until a view is drained, so a slow
+// sink slows the run down instead of queueing unbounded memory.
+class LifeSnapshotter
+{
+public:
+    // rows [firstRow, lastRow) and cols [1, size - 1) are valid; the
+    // frame and halo cells may change while the view is drained
+    struct View
+    {
+        int generation;
+        int size;
+        int firstRow;
+        int lastRow;
+        int **cells;
+        int **pollution;
+    };
+    typedef void (*Sink)(const View &view, void *arg);
+
+private:
+    struct Pending
+    {
+        View view;
+        bool owned; // the engine let go of the tables
+    };
+
+    int size_;
+    Sink sink_;
+    void *arg_;
+    std::vector<std::pair<int **, int **>> spares_;
+    std::deque<Pending> pending_;
+    std::mutex lock_;
+    std::condition_variable changed_;
+    std::thread writer_;
+    bool stop_;
+    long long snapshots_;
+    double stallSeconds_; // engine time spent waiting for a spare pair
+
+    void drain();
+
+public:
+    // spares pairs of size x size tables are allocated up front
+    LifeSnapshotter(int size, int spares, Sink sink, void *arg);
+    virtual ~LifeSnapshotter();
+
+    void submit(const View &view);
+    // the engine is about to overwrite these tables; true if they are
+    // still being drained and now belong to the snapshotter
+    bool release(int **cells, int **pollution);
+    // blocks while the pool is empty
+    void takeSpare(int **&cells, int **&pollution);
+    // waits until every submitted view is drained
+    void flush();
+
+    long long snapshots();
+    double stallSeconds();
+
+    // sink writing prefix.<generation>.<rank>: a text header
+    // "size firstRow lastRow generation" and the owned rows of cells and
+    // pollution as raw ints; arg is a FileSinkArg
+    struct FileSinkArg
+    {
+        std::string prefix;
+        int rank;
+    };
+    static void writeFile(const View &view, void *arg);
+};
+
+#endif /* LIFESNAPSHOTTER_H_ */
@@ -0,0 +1,166 @@
+/*
+ * LifeTimers.cpp
+ */
+
+#include "LifeTimers.h"
+#include "LifeTimersReport.h"
+
+LifeTimers::LifeTimers()
+{
+    reset();
+}
+
+void LifeTimers::reset()
+{
+    for (int phase = 0; phase < PHASES; phase++)
+    {
+        started_[phase] = current_[phase] = total_[phase] = 0.0;
+        perStep_[phase].clear();
+    }
+    generations_.clear();
+}
+
+void LifeTimers::start(Phase phase)
+{
+    started_[phase] = MPI_Wtime();
+}
+
+void LifeTimers::stop(Phase phase)
+{
+    double elapsed = MPI_Wtime() - started_[phase];
+    if (phase < DISTRIBUTE)
+    {
+        current_[phase] += elapsed; // distribution and gather happen once per run
+    }
+    total_[phase] += elapsed;
+}
+
+void LifeTimers::nextStep(int generations)
+{
+    generations_.push_back(generations);
+    for (int phase = 0; phase < PHASES; phase++)
+    {
+        perStep_[phase].push_back(current_[phase]);
+        current_[phase] = 0.0;
+    }
+}
+
+int LifeTimers::steps()
+{
+    return (int)perStep_[COMPUTE].size();
+}
+
+int LifeTimers::generations()
+{
+    int sum = 0;
+    for (size_t i = 0; i < generations_.size(); i++)
+    {
+        sum += generations_[i];
+    }
+    return sum;
+}
+
+const std::vector<int> &LifeTimers::stepGenerations()
+{
+    return generations_;
+}
+
+double LifeTimers::total(Phase phase)
+{
+    return total_[phase];
+}
+
+const std::vector<double> &LifeTimers::perStep(Phase phase)
+{
+    return perStep_[phase];
+}
+
+const char *LifeTimers::name(Phase phase)
+{
+    static const char *names[PHASES] = {"compute",  "haloPost", "haloWait",   "haloFill",
+                                        "haloPack", "swap",     "distribute", "gather"};
+    return names[phase];
+}
+
+void reduceTimer(LifeTimers &timers, LifeTimers::Phase phase, double &min, double &avg, double &max, MPI_Comm comm)
+{
+    int procs;
+    double total = timers.total(phase);
+    MPI_Comm_size(comm, &procs);
+    MPI_Allreduce(&total, &min, 1, MPI_DOUBLE, MPI_MIN, comm);
+    MPI_Allreduce(&total, &max, 1, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(&total, &avg, 1, MPI_DOUBLE, MPI_SUM, comm);
+    avg /= procs;
+}
+
+void reportTimers(LifeTimers &timers, std::ostream &out, MPI_Comm comm)
+{
+    const int PHASES = LifeTimers::PHASES, DISTRIBUTE = LifeTimers::DISTRIBUTE;
+    int rank, procs;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &procs);
+
+    double total[PHASES], minTotal[PHASES], maxTotal[PHASES], sumTotal[PHASES];
+    for (int phase = 0; phase < PHASES; phase++)
+    {
+        total[phase] = timers.total((LifeTimers::Phase)phase);
+    }
+    MPI_Reduce(total, minTotal, PHASES, MPI_DOUBLE, MPI_MIN, 0, comm);
+    MPI_Reduce(total, maxTotal, PHASES, MPI_DOUBLE, MPI_MAX, 0, comm);
+    MPI_Reduce(total, sumTotal, PHASES, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+    // every rank runs the same number of steps
+    int stepCount = timers.steps();
+    std::vector<double> slowest(stepCount);
+    if (rank == 0)
+    {
+        out << "{\"ranks\": " << procs << ", \"steps\": " << stepCount;
+        // perStepMax entries that are totals over several generations
+        int generations = timers.generations();
+        if (generations != stepCount)
+        {
+            const std::vector<int> &stepGenerations = timers.stepGenerations();
+            out << ", \"generations\": " << generations << ", \"generationsPerStep\": [";
+            for (int step = 0; step < stepCount; step++)
+            {
+                out << (step ? ", " : "") << stepGenerations[step];
+            }
+            out << "]";
+        }
+        out << ", \"phases\": {";
+    }
+    for (int phase = 0; phase < PHASES; phase++)
+    {
+        const char *name = LifeTimers::name((LifeTimers::Phase)phase);
+        if (phase >= DISTRIBUTE && rank == 0)
+        {
+            double avg = sumTotal[phase] / procs;
+            out << ", \"" << name << "\": {\"min\": " << minTotal[phase] << ", \"avg\": " << avg
+                << ", \"max\": " << maxTotal[phase] << ", \"imbalance\": " << (avg > 0.0 ? maxTotal[phase] / avg : 1.0)
+                << "}";
+        }
+        if (phase >= DISTRIBUTE)
+        {
+            continue;
+        }
+        const std::vector<double> &perStep = timers.perStep((LifeTimers::Phase)phase);
+        MPI_Reduce(perStep.data(), slowest.data(), stepCount, MPI_DOUBLE, MPI_MAX, 0, comm);
+        if (rank != 0)
+        {
+            continue;
+        }
+        double avg = sumTotal[phase] / procs;
+        out << (phase ? ", " : "") << "\"" << name << "\": {\"min\": " << minTotal[phase]
+            << ", \"avg\": " << avg << ", \"max\": " << maxTotal[phase]
+            << ", \"imbalance\": " << (avg > 0.0 ? maxTotal[phase] / avg : 1.0) << ", \"perStepMax\": [";
+        for (int step = 0; step < stepCount; step++)
+        {
+            out << (step ? ", " : "") << slowest[step];
+        }
+        out << "]}";
+    }
+    if (rank == 0)
+    {
+        out << "}}" << std::endl;
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * LifeTimers.h
+ */
+
+#ifndef LIFETIMERS_H_
+#define LIFETIMERS_H_
+
+#include <vector>
+
+// Per-rank, per-step phase timers for the Life engines. Phases are timed
+// with MPI_Wtime and summed per step. An engine without boundaries between
+// generations (dataflow) closes a whole advance() as one step of several
+// generations. The reductions over ranks are in
+// LifeTimersReport.h, so that the engines need no <mpi.h> for this header.
+class LifeTimers
+{
+public:
+    enum Phase
+    {
+        COMPUTE,    // realStep kernel
+        HALO_POST,  // posting the halo Irecv/Isend
+        HALO_WAIT,  // waiting for the halo transfers
+        HALO_FILL,  // wrapping the halo on a torus
+        HALO_PACK,  // encoding and decoding compressed halos
+        SWAP,       // swapTables
+        DISTRIBUTE, // beforeFirstStep, once per run
+        GATHER,     // afterLastStep, once per run
+        PHASES
+    };
+
+private:
+    double started_[PHASES];
+    double current_[PHASES];             // time spent in the current step
+    double total_[PHASES];               // time spent in the whole run
+    std::vector<double> perStep_[PHASES];
+    std::vector<int> generations_;       // per closed step
+
+public:
+    LifeTimers();
+
+    void start(Phase phase);
+    void stop(Phase phase);
+    // closes the current step, which computed that many generations
+    void nextStep(int generations = 1);
+    void reset();
+
+    int steps();
+    int generations(); // in all closed steps
+    const std::vector<int> &stepGenerations();
+    double total(Phase phase);
+    // one entry per closed step; DISTRIBUTE and GATHER stay zero
+    const std::vector<double> &perStep(Phase phase);
+    static const char *name(Phase phase);
+};
+
+#endif /* LIFETIMERS_H_ */
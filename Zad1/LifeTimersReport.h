@@ -0,0 +1,21 @@
+/*
+ * LifeTimersReport.h
+ */
+
+#ifndef LIFETIMERSREPORT_H_
+#define LIFETIMERSREPORT_H_
+
+#include "LifeTimers.h"
+
+#include <mpi.h>
+#include <ostream>
+
+// Reduces the timers over all ranks of comm into min / avg / max totals, a
+// load-imbalance factor (max / avg) and the slowest rank's time for every
+// step, written as JSON by rank 0. Collective over comm.
+void reportTimers(LifeTimers &timers, std::ostream &out, MPI_Comm comm = MPI_COMM_WORLD);
+// min, avg and max of one phase total over comm, valid on every rank
+void reduceTimer(LifeTimers &timers, LifeTimers::Phase phase, double &min, double &avg, double &max,
+                 MPI_Comm comm = MPI_COMM_WORLD);
+
+#endif /* LIFETIMERSREPORT_H_ */
@@ -3,12 +3,19 @@
  */
 
 #include "Life.h"
-#include "LifeSequentialImplementation.h"
-#include "LifeParallelImplementation.h"
+#include "LifeEngines.h"
+#include "LifeTimersReport.h"
+#include "LifeAutotuner.h"
 #include "Rules.h"
 #include "SimpleRules.h"
+#include "ParamRules.h"
 #include "Alloc.h"
+#include "PatternLoader.h"
+#include "LifeOutOfCore.h"
+#include "CycleDetector.h"
+#include "Args.h"
 #include <iostream>
+#include <fstream>
 #include <cstring>
 #include <unistd.h>
 #include <math.h>
@@ -61,61 +68,231 @@ void simulationInit(Life *life)
 	hwss(life, 70, 80);
 }
 
+struct BoardSetup
+{
+	Rules *rules;
+	bool torus;
+	int size;
+	int rank;
+	int argc;
+	char **argv;
+};
+
+// initial state from -pattern / -soup on every rank, else the built-in one on rank 0
+void prepareBoard(Life *life, void *arg)
+{
+	BoardSetup *setup = (BoardSetup *)arg;
+	life->setRules(setup->rules);
+	if (setup->torus)
+		life->setBoundary(Life::PERIODIC);
+	life->setSize(setup->size);
+
+	if (PatternLoader::hasArgs(setup->argc, setup->argv))
+	{
+		PatternLoader loader(life);
+		if (!loader.loadArgs(setup->argc, setup->argv))
+			MPI_Abort(MPI_COMM_WORLD, 1);
+		life->setDistributedInit(true);
+	}
+	else if (!setup->rank)
+	{
+		simulationInit(life);
+	}
+}
+
+// -out-of-core file [-band rows]: single process, board kept in a
+// memory-mapped file, initial state from -pattern / -soup
+int runOutOfCore(Rules *rules, const char *fileName, long long simulationSize, int steps, int argc, char **argv)
+{
+	LifeOutOfCore life;
+	life.setRules(rules);
+	if (!life.setSize(simulationSize, fileName, intArg(argc, argv, "-band", 256)))
+		return 1;
+	PatternLoader loader(&life);
+	if (!loader.loadArgs(argc, argv))
+		return 1;
+
+	double start = MPI_Wtime();
+	for (int t = 0; t < steps; t++)
+	{
+		life.oneStep();
+	}
+	double end = MPI_Wtime();
+
+	cout << "Out-of-core file : " << fileName << endl;
+	cout << "Total cells      : " << (simulationSize - 2) * (simulationSize - 2) << endl;
+	cout << "File size        : " << 4 * simulationSize * simulationSize / 1024 << "KB" << endl;
+	cout << "Living cells     : " << life.numberOfLivingCells() << endl;
+	cout << "Avg pollution    : " << 100.0 * life.averagePollution() << "%" << endl;
+	cout << "Simulation size  : " << simulationSize << endl;
+	cout << "Simulation steps : " << steps << endl;
+	cout << "Simulation time  : " << (end - start) << " sek. " << endl;
+	cout << "Time per step    : " << (end - start) / steps << " sek. " << endl;
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
-	const int simulationSize = 7500;
-	const int steps = 100;
+	const int simulationSize = intArg(argc, argv, "-size", 7500);
+	const int steps = intArg(argc, argv, "-steps", 100);
+	// -until-steady: stop as soon as cells and pollution settle into a
+	// fixed point or a cycle of period <= history / 2; -steps is the limit
+	const bool untilSteady = flagArg(argc, argv, "-until-steady");
+	CycleDetector detector(intArg(argc, argv, "-history", 64));
+	int stepsDone = steps;
 	double start;
 	int procs, rank;
 
-	MPI_Init(&argc, &argv);
+	int provided;
+	// only the thread calling the engine talks to MPI
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 	MPI_Comm_size(MPI_COMM_WORLD, &procs);
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
 	Rules *rules = new SimpleRules();
-	Life *life;
-	if (procs == 1)
-		life = new LifeSequentialImplementation();
-	else
-		life = new LifeParallelImplementation();
+	// -rule B36/S23[:T50:I10:W2,3,22:M255] replaces SimpleRules, see RuleSpec.h
+	const char *ruleText = stringArg(argc, argv, "-rule", NULL);
+	if (ruleText)
+	{
+		RuleSpec spec;
+		if (!spec.parse(ruleText))
+		{
+			if (!rank)
+				cerr << "bad rule " << ruleText << endl;
+			MPI_Finalize();
+			return 1;
+		}
+		rules = new ParamRules(spec);
+	}
+	const char *outOfCoreFile = stringArg(argc, argv, "-out-of-core", NULL);
+	if (outOfCoreFile)
+	{
+		int result = 0;
+		if (!rank)
+			result = procs == 1 ? runOutOfCore(rules, outOfCoreFile, simulationSize, steps, argc, argv) : 1;
+		if (!rank && procs > 1)
+			cerr << "-out-of-core runs in a single process" << endl;
+		MPI_Finalize();
+		return result;
+	}
 
-	life->setRules(rules);
-	life->setSize(simulationSize);
+	BoardSetup setup = {rules, flagArg(argc, argv, "-torus"), simulationSize, rank, argc, argv};
+	// -engine name|auto, names in LifeEngines.h; knobs -threads n -tile n
+	// (dataflow) and -halo raw|packed|rle (parallel)
+	LifeEngineConfig config(stringArg(argc, argv, "-engine", procs == 1 ? "sequential" : "parallel"),
+							intArg(argc, argv, "-threads", 0), intArg(argc, argv, "-tile", 0),
+							HaloCodec::fromName(stringArg(argc, argv, "-halo", "raw")));
+	if (config.engine == "auto")
+	{
+		// probes every candidate for -probe-steps steps unless the
+		// -tune-cache file already knows this host, size and process count
+		LifeAutotuner tuner;
+		tuner.setProbeSteps(intArg(argc, argv, "-probe-steps", 5));
+		tuner.setCacheFile(stringArg(argc, argv, "-tune-cache", "life_tuning.cache"));
+		tuner.setLog(rank ? NULL : &cout);
+		config = tuner.tune(simulationSize, prepareBoard, &setup, !flagArg(argc, argv, "-retune"));
+	}
+	Life *life = createLifeEngine(config);
+	if (!life)
+	{
+		if (!rank)
+			cerr << "engine " << config.engine << " cannot run on " << procs << " process(es)" << endl;
+		MPI_Finalize();
+		return 1;
+	}
+	prepareBoard(life, &setup);
+	// -timers file.json (or -) : per-phase timings reduced over all ranks
+	const char *timersFile = stringArg(argc, argv, "-timers", NULL);
+	LifeTimers timers;
+	if (timersFile)
+		life->setTimers(&timers);
+	// -snapshot prefix [-snapshot-every n] [-snapshot-spares k] : every n-th
+	// generation is written to prefix.<generation>.<rank> in the background
+	const char *snapshotPrefix = stringArg(argc, argv, "-snapshot", NULL);
+	const int snapshotEvery = snapshotPrefix ? intArg(argc, argv, "-snapshot-every", 10) : 0;
+	LifeSnapshotter::FileSinkArg snapshotFile = {snapshotPrefix ? snapshotPrefix : "", rank};
+	LifeSnapshotter *snapshotter = NULL;
+	if (snapshotPrefix)
+	{
+		snapshotter = new LifeSnapshotter(simulationSize, intArg(argc, argv, "-snapshot-spares", 2),
+										  LifeSnapshotter::writeFile, &snapshotFile);
+		life->setSnapshotter(snapshotter);
+	}
 
 	if (!rank)
 	{
-		simulationInit(life);
 		start = MPI_Wtime();
 	}
 
 	life->beforeFirstStep();
-	for (int t = 0; t < steps; t++)
+	if (untilSteady)
+	{
+		life->setHashing(true);
+		detector.push(life->stateHash());
+	}
+	life->snapshot(0);
+	int chunk = snapshotEvery > 0 ? snapshotEvery : steps;
+	for (int t = 0; !untilSteady && t < steps; t += chunk)
+	{
+		life->advance(min(chunk, steps - t));
+		if (snapshotEvery > 0)
+			life->snapshot(min(t + chunk, steps));
+	}
+	for (int t = 0; untilSteady && t < steps; t++)
 	{
 		life->oneStep();
+		if (snapshotEvery > 0 && (t + 1) % snapshotEvery == 0)
+			life->snapshot(t + 1);
+		if (detector.push(life->stateHash()))
+		{
+			stepsDone = t + 1;
+			break;
+		}
 	}
+	if (snapshotter)
+		snapshotter->flush();
 	life->afterLastStep();
 
 	if (!rank)
 	{
-		int livingCells = life->numberOfLivingCells();
+		long long livingCells = life->numberOfLivingCells();
 		double averagePollution = 100.0 * life->averagePollution();
 		double end = MPI_Wtime();
-		int cellsTotal = (simulationSize - 2) * (simulationSize - 2);
-		int ram = 2 * simulationSize * simulationSize * sizeof(int);
-		int oneBorder = 4 * simulationSize * sizeof(int);
+		long long cellsTotal = (long long)(simulationSize - 2) * (simulationSize - 2);
+		long long ram = 2LL * simulationSize * simulationSize * sizeof(int);
+		long long oneBorder = 4LL * simulationSize * sizeof(int);
 
 		cout << "MPI size         : " << procs << endl;
+		cout << "Engine           : " << config.describe() << endl;
+		cout << "Rule             : " << rules->spec()->describe() << " (" << rowKernelName(rules) << " kernel)" << endl;
 		cout << "Total cells      : " << cellsTotal << endl;
 		cout << "RAM for tables   : " << ram / 1024 << "KB" << endl;
 		cout << "Border size      : " << oneBorder / 1024 << "KB" << endl;
 		cout << "Living cells     : " << livingCells << endl;
 		cout << "Avg pollution    : " << averagePollution << "%" << endl;
 		cout << "Simulation size  : " << simulationSize << endl;
-		cout << "Simulation steps : " << steps << endl;
+		cout << "Simulation steps : " << stepsDone << endl;
+		if (untilSteady)
+			cout << "Steady period    : " << detector.period() << endl;
 		cout << "Simulation time  : " << (end - start) << " sek. " << endl;
-		cout << "Time per step    : " << (end - start) / steps << " sek. " << endl;
+		cout << "Time per step    : " << (end - start) / stepsDone << " sek. " << endl;
 		cout << "pollution@(10,10): " << life->getPollution(10, 10) << endl;
 		cout << "cell@(10,10)     : " << life->getCellState(10, 10) << endl;
+		if (snapshotter)
+			cout << "Snapshots        : " << snapshotter->snapshots() << ", stepping stalled "
+				 << snapshotter->stallSeconds() << " sek." << endl;
+	}
+	delete snapshotter;
+
+	if (timersFile)
+	{
+		if (strcmp(timersFile, "-"))
+		{
+			ofstream out(rank ? "/dev/null" : timersFile);
+			reportTimers(timers, out);
+		}
+		else
+			reportTimers(timers, cout);
 	}
 
 	MPI_Finalize();
@@ -0,0 +1,38 @@
+/*
+ * ParamRules.cpp
+ */
+
+#include "ParamRules.h"
+
+ParamRules::ParamRules(const RuleSpec &spec) : spec_(spec)
+{
+    for (int n = 0; n <= 8; n++)
+    {
+        next_[0][n] = spec_.birth >> n & 1;
+        next_[1][n] = spec_.survive >> n & 1;
+    }
+}
+
+int ParamRules::cellNextState(int cellCurrentState, int liveN, int currentPollution)
+{
+    if (!cellCurrentState && currentPollution > spec_.threshold)
+        return 0;
+    return next_[cellCurrentState][liveN];
+}
+
+int ParamRules::nextPollution(int cellCurrentState, int currentPollution, int pollutionSumNN, int pollutionSumNNN)
+{
+    int p = (spec_.wDiagonal * (currentPollution + pollutionSumNNN) + spec_.wNear * pollutionSumNN) / spec_.divisor +
+            spec_.inc * cellCurrentState;
+    return p > spec_.maxPollution ? spec_.maxPollution : p;
+}
+
+int ParamRules::getMaxPollution()
+{
+    return spec_.maxPollution;
+}
+
+const RuleSpec *ParamRules::spec()
+{
+    return &spec_;
+}
@@ -0,0 +1,28 @@
+/*
+ * ParamRules.h
+ */
+
+#ifndef PARAMRULES_H_
+#define PARAMRULES_H_
+
+#include "RuleSpec.h"
+#include "Rules.h"
+
+// Rules given by a RuleSpec. The engines do not call the virtual methods:
+// they pick a step kernel for spec() once, in Life::setRules.
+class ParamRules : public Rules
+{
+private:
+    RuleSpec spec_;
+    int next_[2][9]; // next state for [state][live neighbours], birth ignoring pollution
+
+public:
+    ParamRules(const RuleSpec &spec);
+
+    int cellNextState(int cellCurrentState, int liveN, int currentPollution);
+    int nextPollution(int cellCurrentState, int currentPollution, int pollutionSumNN, int pollutionSumNNN);
+    int getMaxPollution();
+    const RuleSpec *spec();
+};
+
+#endif /* PARAMRULES_H_ */
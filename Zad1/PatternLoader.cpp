@@ -0,0 +1,258 @@
+/*
+ * PatternLoader.cpp
+ */
+
+#include "PatternLoader.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+static unsigned long long splitMix64(unsigned long long &state)
+{
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+PatternLoader::PatternLoader(Life *life)
+{
+    life_ = life;
+    outOfCore_ = 0;
+    firstRow_ = life->firstOwnedRow();
+    lastRow_ = life->lastOwnedRow();
+    colLimit_ = life->getSize() - 1;
+    placed_ = 0;
+}
+
+PatternLoader::PatternLoader(LifeOutOfCore *life)
+{
+    life_ = 0;
+    outOfCore_ = life;
+    firstRow_ = 1;
+    lastRow_ = life->getSize() - 1;
+    colLimit_ = life->getSize() - 1;
+    placed_ = 0;
+}
+
+void PatternLoader::place(long long row, long long col)
+{
+    // the frame (row/col 0 and size - 1) is never computed, so it stays dead
+    if (row < firstRow_ || row >= lastRow_ || col < 1 || col >= colLimit_)
+        return;
+    if (outOfCore_)
+        outOfCore_->bringToLife(row, col);
+    else
+        life_->bringToLife((int)row, (int)col);
+    placed_++;
+}
+
+long long PatternLoader::placedCells()
+{
+    return placed_;
+}
+
+PatternLoader::Format PatternLoader::detectFormat(istream &in)
+{
+    streampos start = in.tellg();
+    Format format = PLAINTEXT;
+    string line;
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '\r')
+            continue;
+        if (line.compare(0, 10, "#Life 1.06") == 0)
+        {
+            format = LIFE_106;
+            break;
+        }
+        if (line[0] == '#')
+            continue; // RLE comment lines (#N, #C, #O, ...)
+        if (line[0] == '!')
+        {
+            format = PLAINTEXT;
+            break;
+        }
+        size_t pos = line.find_first_not_of(" \t");
+        if (pos != string::npos && line[pos] == 'x' && line.find('=') != string::npos)
+            format = RLE;
+        break;
+    }
+    in.clear();
+    in.seekg(start);
+    return format;
+}
+
+bool PatternLoader::load(const char *fileName, long long row, long long col, Format format)
+{
+    ifstream in(fileName);
+    if (!in)
+    {
+        cerr << "PatternLoader: cannot open " << fileName << endl;
+        return false;
+    }
+    return load(in, row, col, format);
+}
+
+bool PatternLoader::load(istream &in, long long row, long long col, Format format)
+{
+    if (format == AUTO)
+        format = detectFormat(in);
+    switch (format)
+    {
+        case RLE:
+            return loadRLE(in, row, col);
+        case LIFE_106:
+            return loadLife106(in, row, col);
+        default:
+            return loadPlaintext(in, row, col);
+    }
+}
+
+bool PatternLoader::loadRLE(istream &in, long long row, long long col)
+{
+    string line;
+    bool header = false;
+    while (!header && getline(in, line))
+    {
+        if (line.empty() || line[0] == '#' || line[0] == '\r')
+            continue;
+        header = true; // "x = m, y = n, rule = ..." - the rule is given by Rules
+    }
+    if (!header)
+    {
+        cerr << "PatternLoader: RLE header missing" << endl;
+        return false;
+    }
+
+    long long y = row;
+    long long x = col;
+    long long count = 0;
+    char c;
+    while (in.get(c))
+    {
+        if (isdigit((unsigned char)c))
+        {
+            count = count * 10 + (c - '0');
+            continue;
+        }
+        long long run = count ? count : 1;
+        count = 0;
+        if (c == '!')
+            return true;
+        if (c == '$')
+        {
+            y += run;
+            x = col;
+            if (y >= lastRow_)
+                return true; // everything below belongs to other processes
+        }
+        else if (c == 'b' || c == '.')
+        {
+            x += run;
+        }
+        else if (isalpha((unsigned char)c))
+        {
+            // 'o' and the multi-state letters are alive
+            if (y >= firstRow_)
+                for (long long i = 0; i < run; i++)
+                    place(y, x + i);
+            x += run;
+        }
+        else if (c == '#')
+        {
+            getline(in, line); // trailing comment
+        }
+        else if (!isspace((unsigned char)c))
+        {
+            cerr << "PatternLoader: unexpected '" << c << "' in RLE data" << endl;
+            return false;
+        }
+    }
+    return true; // missing '!' is tolerated
+}
+
+bool PatternLoader::loadLife106(istream &in, long long row, long long col)
+{
+    string line;
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '#' || line[0] == '\r')
+            continue;
+        istringstream fields(line);
+        long long dx, dy;
+        if (!(fields >> dx >> dy))
+        {
+            cerr << "PatternLoader: bad Life 1.06 line '" << line << "'" << endl;
+            return false;
+        }
+        place(row + dy, col + dx);
+    }
+    return true;
+}
+
+bool PatternLoader::loadPlaintext(istream &in, long long row, long long col)
+{
+    string line;
+    long long y = row;
+    while (y < lastRow_ && getline(in, line))
+    {
+        if (!line.empty() && line[0] == '!')
+            continue;
+        if (y >= firstRow_)
+            for (size_t i = 0; i < line.size(); i++)
+                if (line[i] == 'O' || line[i] == '*')
+                    place(y, col + (long long)i);
+        y++;
+    }
+    return true;
+}
+
+void PatternLoader::soup(long long row, long long col, long long height, long long width, double density,
+                         unsigned long long seed)
+{
+    long long first = row > firstRow_ ? row : firstRow_;
+    long long last = row + height < lastRow_ ? row + height : lastRow_;
+    for (long long r = first; r < last; r++)
+    {
+        unsigned long long state = seed ^ ((unsigned long long)r * 0xD1B54A32D192ED03ULL);
+        for (long long c = col; c < col + width; c++)
+            if ((splitMix64(state) >> 11) * 0x1.0p-53 < density)
+                place(r, c);
+    }
+}
+
+bool PatternLoader::loadArgs(int argc, char **argv)
+{
+    bool ok = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-pattern") && i + 3 < argc)
+        {
+            ok &= load(argv[i + 1], atoll(argv[i + 2]), atoll(argv[i + 3]));
+            i += 3;
+        }
+        else if (!strcmp(argv[i], "-soup") && i + 6 < argc)
+        {
+            soup(atoll(argv[i + 1]), atoll(argv[i + 2]), atoll(argv[i + 3]), atoll(argv[i + 4]), atof(argv[i + 5]),
+                 strtoull(argv[i + 6], NULL, 10));
+            i += 6;
+        }
+    }
+    return ok;
+}
+
+bool PatternLoader::hasArgs(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+        if (!strcmp(argv[i], "-pattern") || !strcmp(argv[i], "-soup"))
+            return true;
+    return false;
+}
@@ -0,0 +1,66 @@
+/*
+ * PatternLoader.h
+ */
+
+#ifndef PATTERNLOADER_H_
+#define PATTERNLOADER_H_
+
+#include "Life.h"
+#include "LifeOutOfCore.h"
+
+#include <istream>
+
+// Places standard pattern files (RLE, Life 1.06, plaintext .cells) and random
+// soups on a board. Only the rows owned by the calling process are decoded,
+// so in MPI mode every rank loads its own part of the initial state and no
+// rank ever builds the full board.
+class PatternLoader
+{
+public:
+    enum Format
+    {
+        AUTO,
+        RLE,
+        LIFE_106,
+        PLAINTEXT
+    };
+
+private:
+    Life *life_;
+    LifeOutOfCore *outOfCore_;
+    long long firstRow_; // first row owned by this process
+    long long lastRow_;  // one past the last row owned by this process
+    long long colLimit_; // cols [1, colLimit_) are inside the board
+    long long placed_;   // live cells placed by this process
+
+    void place(long long row, long long col);
+    bool loadRLE(std::istream &in, long long row, long long col);
+    bool loadLife106(std::istream &in, long long row, long long col);
+    bool loadPlaintext(std::istream &in, long long row, long long col);
+
+public:
+    // life must already have its size set
+    PatternLoader(Life *life);
+    PatternLoader(LifeOutOfCore *life);
+
+    // pattern's top-left corner goes to (row, col); false on I/O or parse error
+    bool load(const char *fileName, long long row, long long col, Format format = AUTO);
+    bool load(std::istream &in, long long row, long long col, Format format);
+
+    // random soup, identical for every process count because each row is
+    // generated from its own seed
+    void soup(long long row, long long col, long long height, long long width, double density,
+              unsigned long long seed);
+
+    // command line initial state, applied in order:
+    //   -pattern file row col                    pattern file at (row, col)
+    //   -soup row col height width density seed  random soup
+    bool loadArgs(int argc, char **argv);
+    static bool hasArgs(int argc, char **argv);
+
+    long long placedCells();
+
+    static Format detectFormat(std::istream &in);
+};
+
+#endif /* PATTERNLOADER_H_ */
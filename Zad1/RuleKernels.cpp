@@ -0,0 +1,128 @@
+/*
+ * RuleKernels.cpp
+ */
+
+#include "RuleKernels.h"
+#include "RuleSpec.h"
+
+// n in the neighbour count set MASK, as compares: SSE2 has no per-lane
+// variable shift, so MASK >> n would keep the loop below scalar
+template <unsigned MASK> static inline int inSet(int n)
+{
+    return ((MASK & 1) && n == 0) | (MASK >> 1 & 1 && n == 1) | (MASK >> 2 & 1 && n == 2) | (MASK >> 3 & 1 && n == 3) |
+           (MASK >> 4 & 1 && n == 4) | (MASK >> 5 & 1 && n == 5) | (MASK >> 6 & 1 && n == 6) |
+           (MASK >> 7 & 1 && n == 7) | (MASK >> 8 & 1 && n == 8);
+}
+
+// branch-free so that the column loop vectorizes with the constants folded in.
+// The output rows cannot overlap the input rows, but proving that would take
+// more run-time alias checks than GCC makes, and at -O2 it adds no scalar
+// epilogue; omp simd (built with -fopenmp-simd) settles both.
+template <unsigned BIRTH, unsigned SURVIVE, int THRESHOLD, int INC_, int W_DIAGONAL, int W_NEAR, int DIVISOR,
+          int MAX_POLLUTION_>
+static void presetRow(const RowRules *, int **cells, int **pollution, int **cellsNext, int **pollutionNext, int row,
+                      int firstCol, int lastCol)
+{
+    const int *up = cells[row - 1], *mid = cells[row], *down = cells[row + 1];
+    const int *pUp = pollution[row - 1], *pMid = pollution[row], *pDown = pollution[row + 1];
+    int *next = cellsNext[row];
+    int *pNext = pollutionNext[row];
+#pragma omp simd
+    for (int col = firstCol; col < lastCol; col++)
+    {
+        int state = mid[col];
+        int p = pMid[col];
+        int liveN = up[col - 1] + up[col] + up[col + 1] + mid[col - 1] + mid[col + 1] + down[col - 1] + down[col] +
+                    down[col + 1];
+        int born = inSet<BIRTH>(liveN) & (p <= THRESHOLD);
+        int survives = inSet<SURVIVE>(liveN);
+        next[col] = state ? survives : born;
+        int sumNN = pDown[col] + pUp[col] + pMid[col - 1] + pMid[col + 1];
+        int sumNNN = pUp[col - 1] + pUp[col + 1] + pDown[col - 1] + pDown[col + 1];
+        int q = (W_DIAGONAL * (p + sumNNN) + W_NEAR * sumNN) / DIVISOR + INC_ * state;
+        pNext[col] = q > MAX_POLLUTION_ ? MAX_POLLUTION_ : q;
+    }
+}
+
+static void tableRow(const RowRules *rules, int **cells, int **pollution, int **cellsNext, int **pollutionNext,
+                     int row, int firstCol, int lastCol)
+{
+    const RuleSpec &spec = rules->spec;
+    const int(*transition)[9] = rules->transition;
+    const int *up = cells[row - 1], *mid = cells[row], *down = cells[row + 1];
+    const int *pUp = pollution[row - 1], *pMid = pollution[row], *pDown = pollution[row + 1];
+    int *next = cellsNext[row];
+    int *pNext = pollutionNext[row];
+    for (int col = firstCol; col < lastCol; col++)
+    {
+        int state = mid[col];
+        int p = pMid[col];
+        int liveN = up[col - 1] + up[col] + up[col + 1] + mid[col - 1] + mid[col + 1] + down[col - 1] + down[col] +
+                    down[col + 1];
+        next[col] = transition[2 * (p > spec.threshold) + state][liveN];
+        int sumNN = pDown[col] + pUp[col] + pMid[col - 1] + pMid[col + 1];
+        int sumNNN = pUp[col - 1] + pUp[col + 1] + pDown[col - 1] + pDown[col + 1];
+        int q = (spec.wDiagonal * (p + sumNNN) + spec.wNear * sumNN) / spec.divisor + spec.inc * state;
+        pNext[col] = q > spec.maxPollution ? spec.maxPollution : q;
+    }
+}
+
+static void virtualRow(const RowRules *bound, int **cells, int **pollution, int **cellsNext, int **pollutionNext,
+                       int row, int firstCol, int lastCol)
+{
+    Rules *rules = bound->rules;
+    for (int col = firstCol; col < lastCol; col++)
+    {
+        int currentState = cells[row][col];
+        int currentPollution = pollution[row][col];
+        int liveN = cells[row - 1][col] + cells[row + 1][col] + cells[row][col - 1] + cells[row][col + 1] +
+                    cells[row - 1][col - 1] + cells[row - 1][col + 1] + cells[row + 1][col - 1] +
+                    cells[row + 1][col + 1];
+        cellsNext[row][col] = rules->cellNextState(currentState, liveN, currentPollution);
+        pollutionNext[row][col] = rules->nextPollution(
+            currentState, currentPollution,
+            pollution[row + 1][col] + pollution[row - 1][col] + pollution[row][col - 1] + pollution[row][col + 1],
+            pollution[row - 1][col - 1] + pollution[row - 1][col + 1] + pollution[row + 1][col - 1] +
+                pollution[row + 1][col + 1]);
+    }
+}
+
+struct Preset
+{
+    RuleSpec spec;
+    RowKernel kernel;
+};
+
+static const Preset presets[] = {
+    {RuleSpec(1u << 3, 1u << 2 | 1u << 3), presetRow<1u << 3, 1u << 2 | 1u << 3, 50, 10, 2, 3, 22, 255>},
+    {RuleSpec(1u << 3 | 1u << 6, 1u << 2 | 1u << 3),
+     presetRow<1u << 3 | 1u << 6, 1u << 2 | 1u << 3, 50, 10, 2, 3, 22, 255>},
+};
+
+RowKernel selectRowKernel(Rules *rules, RowRules *bound)
+{
+    const RuleSpec *spec = rules ? rules->spec() : 0;
+    if (bound)
+    {
+        bound->rules = rules;
+        bound->spec = spec ? *spec : RuleSpec();
+        for (int n = 0; n <= 8; n++)
+        {
+            bound->transition[0][n] = bound->spec.birth >> n & 1;
+            bound->transition[1][n] = bound->transition[3][n] = bound->spec.survive >> n & 1;
+            bound->transition[2][n] = 0;
+        }
+    }
+    if (!spec)
+        return virtualRow;
+    for (unsigned i = 0; i < sizeof(presets) / sizeof(presets[0]); i++)
+        if (presets[i].spec == *spec)
+            return presets[i].kernel;
+    return tableRow;
+}
+
+const char *rowKernelName(Rules *rules)
+{
+    RowKernel kernel = selectRowKernel(rules);
+    return kernel == virtualRow ? "virtual" : kernel == tableRow ? "table" : "preset";
+}
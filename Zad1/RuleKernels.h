@@ -0,0 +1,35 @@
+/*
+ * RuleKernels.h
+ */
+
+#ifndef RULEKERNELS_H_
+#define RULEKERNELS_H_
+
+#include "Rules.h"
+#include "RuleSpec.h"
+
+// What a row kernel reads besides the tables, bound once with the kernel.
+struct RowRules
+{
+    Rules *rules;
+    RuleSpec spec; // a copy of *rules->spec(), if there is one
+    // [state][live neighbours] for a clean cell, [2 + state][..] for a polluted one
+    int transition[4][9];
+};
+
+// Computes cols [firstCol, lastCol) of one row of the next generation.
+typedef void (*RowKernel)(const RowRules *rules, int **cells, int **pollution, int **cellsNext, int **pollutionNext, int row,
+                          int firstCol, int lastCol);
+
+// Kernel for rules, best first:
+//   a preset spec (B3/S23 and B36/S23 with the SimpleRules pollution) gets a
+//   template instance with every parameter a compile-time constant, so the
+//   loop vectorizes and the division folds into a multiplication;
+//   any other spec gets a kernel driven by a transition table built from it;
+//   rules without a spec go through the virtual Rules methods.
+// bound, if given, receives what the kernel is to be called with.
+RowKernel selectRowKernel(Rules *rules, RowRules *bound = 0);
+// "preset", "table" or "virtual", for reports
+const char *rowKernelName(Rules *rules);
+
+#endif /* RULEKERNELS_H_ */
@@ -0,0 +1,110 @@
+/*
+ * RuleSpec.cpp
+ */
+
+#include "RuleSpec.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+using namespace std;
+
+RuleSpec::RuleSpec(unsigned birth, unsigned survive, int threshold, int inc, int wDiagonal, int wNear, int divisor,
+                   int maxPollution)
+    : birth(birth), survive(survive), threshold(threshold), inc(inc), wDiagonal(wDiagonal), wNear(wNear),
+      divisor(divisor), maxPollution(maxPollution)
+{
+}
+
+// digits 0-8 after the letter, e.g. "B36" -> bits 3 and 6
+static bool parseMask(const string &field, char letter, unsigned &mask)
+{
+    if (field.empty() || toupper((unsigned char)field[0]) != letter)
+        return false;
+    mask = 0;
+    for (size_t i = 1; i < field.size(); i++)
+    {
+        if (field[i] < '0' || field[i] > '8')
+            return false;
+        mask |= 1u << (field[i] - '0');
+    }
+    return true;
+}
+
+// comma separated integers, exactly count of them
+static bool parseInts(const string &text, int *values, int count)
+{
+    istringstream in(text);
+    string item;
+    int n = 0;
+    while (getline(in, item, ','))
+    {
+        char *end;
+        long value = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end || n == count)
+            return false;
+        values[n++] = (int)value;
+    }
+    return n == count;
+}
+
+bool RuleSpec::parse(const string &text)
+{
+    RuleSpec spec;
+    istringstream in(text);
+    string part;
+    if (!getline(in, part, ':'))
+        return false;
+    size_t slash = part.find('/');
+    if (slash == string::npos || !parseMask(part.substr(0, slash), 'B', spec.birth) ||
+        !parseMask(part.substr(slash + 1), 'S', spec.survive))
+        return false;
+    while (getline(in, part, ':'))
+    {
+        if (part.empty())
+            return false;
+        char key = (char)toupper((unsigned char)part[0]);
+        string value = part.substr(1);
+        int weights[3];
+        if (key == 'T' && parseInts(value, &spec.threshold, 1))
+            continue;
+        if (key == 'I' && parseInts(value, &spec.inc, 1))
+            continue;
+        if (key == 'M' && parseInts(value, &spec.maxPollution, 1))
+            continue;
+        if (key == 'W' && parseInts(value, weights, 3) && weights[2] > 0)
+        {
+            spec.wDiagonal = weights[0];
+            spec.wNear = weights[1];
+            spec.divisor = weights[2];
+            continue;
+        }
+        return false;
+    }
+    *this = spec;
+    return true;
+}
+
+string RuleSpec::describe() const
+{
+    ostringstream out;
+    out << "B";
+    for (int n = 0; n <= 8; n++)
+        if (birth >> n & 1)
+            out << n;
+    out << "/S";
+    for (int n = 0; n <= 8; n++)
+        if (survive >> n & 1)
+            out << n;
+    out << ":T" << threshold << ":I" << inc << ":W" << wDiagonal << "," << wNear << "," << divisor << ":M"
+        << maxPollution;
+    return out.str();
+}
+
+bool RuleSpec::operator==(const RuleSpec &other) const
+{
+    return birth == other.birth && survive == other.survive && threshold == other.threshold && inc == other.inc &&
+           wDiagonal == other.wDiagonal && wNear == other.wNear && divisor == other.divisor &&
+           maxPollution == other.maxPollution;
+}
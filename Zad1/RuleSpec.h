@@ -0,0 +1,38 @@
+/*
+ * RuleSpec.h
+ */
+
+#ifndef RULESPEC_H_
+#define RULESPEC_H_
+
+#include <string>
+
+// Outer-totalistic rule with pollution, the parameters SimpleRules fixes:
+//   a dead cell with n live neighbours is born if bit n of birth is set and
+//   its pollution is <= threshold, a live one survives if bit n of survive
+//   is set; pollution becomes
+//   min(max, (wDiagonal * (p + sumNNN) + wNear * sumNN) / divisor + inc * state)
+// Text form: "B36/S23" optionally followed by ":T50:I10:W2,3,22:M255"
+// (threshold, inc, wDiagonal,wNear,divisor, max); omitted parts keep the
+// SimpleRules values.
+struct RuleSpec
+{
+    unsigned birth;
+    unsigned survive;
+    int threshold;
+    int inc;
+    int wDiagonal; // centre and diagonal neighbours
+    int wNear;     // edge neighbours
+    int divisor;
+    int maxPollution;
+
+    RuleSpec(unsigned birth = 1u << 3, unsigned survive = 1u << 2 | 1u << 3, int threshold = 50, int inc = 10,
+             int wDiagonal = 2, int wNear = 3, int divisor = 22, int maxPollution = 255);
+
+    // false (and the spec unchanged) on a malformed description
+    bool parse(const std::string &text);
+    std::string describe() const;
+    bool operator==(const RuleSpec &other) const;
+};
+
+#endif /* RULESPEC_H_ */
@@ -6,3 +6,7 @@
 
 Rules::Rules() {
 }
+
+const RuleSpec *Rules::spec() {
+	return 0;
+}
@@ -6,14 +6,20 @@
 #ifndef RULES_H_
 #define RULES_H_
 
+struct RuleSpec;
+
 class Rules
 {
 public:
 	Rules();
+	// parameters the engines may compile the rule into, NULL if the rule
+	// is only available through the virtual methods below
+	virtual const RuleSpec *spec();
 	virtual int cellNextState(int cellCurrentState, int liveN, int currentPollution) = 0;
 	virtual int nextPollution(int cellCurrentState, int currentPollution, int pollutionSumNN,
 							  int pollutionSumNNN) = 0;
 	virtual int getMaxPollution() = 0;
+	virtual ~Rules() {}
 };
 
 #endif /* RULES_H_ */
\ No newline at end of file
@@ -9,6 +9,12 @@
 SimpleRules::SimpleRules() {
 }
 
+// B3/S23 with this class's pollution constants
+const RuleSpec *SimpleRules::spec() {
+	static const RuleSpec simple( 1u << 3, 1u << 2 | 1u << 3, 50, INC, 2, 3, 22, MAX_POLLUTION );
+	return &simple;
+}
+
 int SimpleRules::cellNextState(int cellCurrentState, int liveN, int currentPollution) {
 	if ( ( currentPollution > 50 ) && ( liveN == 3 ) && ( cellCurrentState == 0 ) ) return 0; 
 	if ( liveN == 3 ) return 1;
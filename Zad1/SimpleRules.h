@@ -8,6 +8,7 @@
 #define SIMPLERULES_H_
 
 #include"Rules.h"
+#include "RuleSpec.h"
 
 #define MAX_POLLUTION 255
 #define INC 10
@@ -21,6 +22,7 @@ public:
 	int getMaxPollution() {
 		return MAX_POLLUTION;
 	}
+	const RuleSpec *spec();
 };
 
 #endif /* RANDOMRULES_H_ */
\ No newline at end of file
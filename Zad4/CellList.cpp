@@ -0,0 +1,60 @@
+/*
+ * CellList.cpp
+ */
+
+#include "CellList.h"
+
+#include <math.h>
+
+CellList::CellList()
+{
+    cellSize_ = 1.0;
+    x0_ = y0_ = 0.0;
+    columns_ = rows_ = 0;
+}
+
+void CellList::build(const double *x, const double *y, int particles, double minCellSize)
+{
+    double xMin = x[0], xMax = x[0], yMin = y[0], yMax = y[0];
+#pragma omp parallel for reduction(min : xMin, yMin) reduction(max : xMax, yMax)
+    for (int idx = 0; idx < particles; idx++)
+    {
+        xMin = fmin(xMin, x[idx]);
+        xMax = fmax(xMax, x[idx]);
+        yMin = fmin(yMin, y[idx]);
+        yMax = fmax(yMax, y[idx]);
+    }
+
+    cellSize_ = minCellSize;
+    double width = xMax - xMin, height = yMax - yMin;
+    double bins = (width / cellSize_ + 1.0) * (height / cellSize_ + 1.0);
+    if (bins > 2.0 * particles + 16)
+        cellSize_ *= sqrt(bins / (2.0 * particles + 16));
+    columns_ = (int)(width / cellSize_) + 1;
+    rows_ = (int)(height / cellSize_) + 1;
+    x0_ = xMin;
+    y0_ = yMin;
+
+    cellOf_.resize(particles);
+    order_.resize(particles);
+    start_.assign(columns_ * rows_ + 1, 0);
+
+#pragma omp parallel for
+    for (int idx = 0; idx < particles; idx++)
+    {
+        int column = (int)((x[idx] - x0_) / cellSize_);
+        int row = (int)((y[idx] - y0_) / cellSize_);
+        column = column < columns_ ? column : columns_ - 1;
+        row = row < rows_ ? row : rows_ - 1;
+        cellOf_[idx] = cell(column, row);
+    }
+
+    // counting sort, stable so that bins keep the original particle order
+    for (int idx = 0; idx < particles; idx++)
+        start_[cellOf_[idx] + 1]++;
+    for (int b = 0; b < columns_ * rows_; b++)
+        start_[b + 1] += start_[b];
+    std::vector<int> next(start_.begin(), start_.end() - 1);
+    for (int idx = 0; idx < particles; idx++)
+        order_[next[cellOf_[idx]]++] = idx;
+}
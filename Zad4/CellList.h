@@ -0,0 +1,41 @@
+/*
+ * CellList.h
+ */
+
+#ifndef CELLLIST_H_
+#define CELLLIST_H_
+
+#include <vector>
+
+// Square grid of bins over the particles' bounding box, rebuilt from scratch
+// by a counting sort. With bins at least as wide as the interaction range,
+// every partner of a particle lies in the 3x3 bins around its own.
+class CellList
+{
+private:
+    double cellSize_;
+    double x0_, y0_;          // lower left corner of bin (0, 0)
+    int columns_, rows_;
+    std::vector<int> start_;  // particles of bin b are order_[start_[b] .. start_[b + 1])
+    std::vector<int> order_;  // particle indices sorted by bin
+    std::vector<int> cellOf_; // bin of every particle
+
+public:
+    CellList();
+
+    // bins are at least minCellSize wide; they grow when the box is so
+    // sparse that there would be more than about two bins per particle
+    void build(const double *x, const double *y, int particles, double minCellSize);
+
+    int columns() const { return columns_; }
+    int rows() const { return rows_; }
+    double cellSize() const { return cellSize_; }
+    int cellOf(int particle) const { return cellOf_[particle]; }
+    int cell(int column, int row) const { return row * columns_ + column; }
+    const int *begin(int cell) const { return order_.data() + start_[cell]; }
+    const int *end(int cell) const { return order_.data() + start_[cell + 1]; }
+    // particle indices grouped by bin, row by row
+    const int *order() const { return order_.data(); }
+};
+
+#endif /* CELLLIST_H_ */
@@ -10,3 +10,13 @@
 Force::Force() {
 }
 
+void Force::values( const double *distances, double *forces, int n ) {
+	for ( int i = 0; i < n; i++ )
+		forces[ i ] = value( distances[ i ] );
+}
+
+void Force::valuesSingle( const float *distances, float *forces, int n ) {
+	for ( int i = 0; i < n; i++ )
+		forces[ i ] = (float)value( distances[ i ] );
+}
+
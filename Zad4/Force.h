@@ -13,6 +13,12 @@ public:
 	Force();
 
 	virtual double value( double distance ) = 0;
+	// forces[i] = value( distances[i] ); the default just calls value,
+	// forces with a vectorizable formula should override it
+	virtual void values( const double *distances, double *forces, int n );
+	// single precision batch for the float pair loops; by default value
+	// in double, rounded
+	virtual void valuesSingle( const float *distances, float *forces, int n );
 };
 
 #endif /* FORCE_H_ */
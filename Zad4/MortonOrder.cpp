@@ -0,0 +1,100 @@
+/*
+ * MortonOrder.cpp
+ */
+
+#include "MortonOrder.h"
+
+#include <math.h>
+#include <omp.h>
+
+// the 16 low bits of v moved to the even bit positions
+static inline unsigned spread(unsigned v)
+{
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+void MortonOrder::build(const double *x, const double *y, int particles)
+{
+    double xMin = x[0], xMax = x[0], yMin = y[0], yMax = y[0];
+#pragma omp parallel for reduction(min : xMin, yMin) reduction(max : xMax, yMax)
+    for (int idx = 0; idx < particles; idx++)
+    {
+        xMin = fmin(xMin, x[idx]);
+        xMax = fmax(xMax, x[idx]);
+        yMin = fmin(yMin, y[idx]);
+        yMax = fmax(yMax, y[idx]);
+    }
+    // one scale for both axes, so that the curve's cells stay square
+    double extent = fmax(xMax - xMin, yMax - yMin);
+    double scale = extent > 0.0 ? 65535.0 / extent : 0.0;
+
+    keys_.resize(particles);
+    keysScratch_.resize(particles);
+    order_.resize(particles);
+    orderScratch_.resize(particles);
+#pragma omp parallel for
+    for (int idx = 0; idx < particles; idx++)
+    {
+        unsigned column = (unsigned)((x[idx] - xMin) * scale);
+        unsigned row = (unsigned)((y[idx] - yMin) * scale);
+        keys_[idx] = spread(column) | (spread(row) << 1);
+        order_[idx] = idx;
+    }
+    sortKeys(particles);
+}
+
+// every thread counts the digits of its own static range, the offsets are
+// laid out digit by digit and thread by thread within a digit, and every
+// thread scatters its range in order: each pass is stable
+void MortonOrder::sortKeys(int particles)
+{
+#pragma omp parallel
+    {
+        const int threads = omp_get_num_threads();
+        const int thread = omp_get_thread_num();
+        const int first = (int)((long long)particles * thread / threads);
+        const int last = (int)((long long)particles * (thread + 1) / threads);
+
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+#pragma omp single
+            offsets_.assign(threads * 256, 0);
+
+            int *offsets = offsets_.data() + thread * 256;
+            for (int k = first; k < last; k++)
+                offsets[(keys_[k] >> shift) & 0xFF]++;
+#pragma omp barrier
+
+#pragma omp single
+            {
+                int offset = 0;
+                for (int digit = 0; digit < 256; digit++)
+                    for (int t = 0; t < threads; t++)
+                    {
+                        int count = offsets_[t * 256 + digit];
+                        offsets_[t * 256 + digit] = offset;
+                        offset += count;
+                    }
+            }
+
+            for (int k = first; k < last; k++)
+            {
+                int slot = offsets[(keys_[k] >> shift) & 0xFF]++;
+                keysScratch_[slot] = keys_[k];
+                orderScratch_[slot] = order_[k];
+            }
+#pragma omp barrier
+
+#pragma omp single
+            {
+                keys_.swap(keysScratch_);
+                order_.swap(orderScratch_);
+            }
+        }
+    }
+}
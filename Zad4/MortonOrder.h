@@ -0,0 +1,30 @@
+/*
+ * MortonOrder.h
+ */
+
+#ifndef MORTONORDER_H_
+#define MORTONORDER_H_
+
+#include <vector>
+
+// Order of the particles along a Morton (Z-order) curve over their bounding
+// box: 16 bits per coordinate, interleaved into a 32-bit key and sorted by
+// a parallel LSD radix sort, four stable 8-bit passes with per-thread
+// counts. Particles close on the curve are close in space.
+class MortonOrder
+{
+private:
+    std::vector<unsigned> keys_, keysScratch_;
+    std::vector<int> order_, orderScratch_;
+    std::vector<int> offsets_; // per thread and digit, threads * 256
+
+    void sortKeys(int particles);
+
+public:
+    void build(const double *x, const double *y, int particles);
+
+    // the particle that belongs in slot k, for k < particles
+    const int *order() const { return order_.data(); }
+};
+
+#endif /* MORTONORDER_H_ */
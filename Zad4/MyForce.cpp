@@ -7,6 +7,95 @@
 
 #include "MyForce.h"
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// exp and cos written out so that a simd loop can inline them: libm calls
+// keep the compiler from vectorizing. Arguments are reduced Cody-Waite style
+// and rounded with the 1.5 * 2^52 trick, which also leaves the integer in
+// the low mantissa bits.
+
+static constexpr double ROUNDER = 6755399441055744.0;
+
+static inline double bitsToDouble( uint64_t bits ) {
+	double d;
+	memcpy( &d, &bits, sizeof d );
+	return d;
+}
+
+static inline uint64_t doubleToBits( double d ) {
+	uint64_t bits;
+	memcpy( &bits, &d, sizeof bits );
+	return bits;
+}
+
+static constexpr float ROUNDER_F = 12582912.0f;
+
+static inline float bitsToFloat( uint32_t bits ) {
+	float f;
+	memcpy( &f, &bits, sizeof f );
+	return f;
+}
+
+static inline uint32_t floatToBits( float f ) {
+	uint32_t bits;
+	memcpy( &bits, &f, sizeof bits );
+	return bits;
+}
+
+// -2^51 < z <= 0; flushes to 0 below about -708
+static inline double expNonPositive( double z ) {
+	double shifted = z * 1.4426950408889634 + ROUNDER;
+	double k = shifted - ROUNDER;
+	double r = z - k * 6.93147180369123816490e-01 - k * 1.90821492927058770002e-10;
+	double p = 1.0 / 479001600.0;
+	p = p * r + 1.0 / 39916800.0;
+	p = p * r + 1.0 / 3628800.0;
+	p = p * r + 1.0 / 362880.0;
+	p = p * r + 1.0 / 40320.0;
+	p = p * r + 1.0 / 5040.0;
+	p = p * r + 1.0 / 720.0;
+	p = p * r + 1.0 / 120.0;
+	p = p * r + 1.0 / 24.0;
+	p = p * r + 1.0 / 6.0;
+	p = p * r + 0.5;
+	p = p * r + 1.0;
+	p = p * r + 1.0;
+	int64_t exponent = (int64_t)( doubleToBits( k + 1023.0 + ROUNDER ) - doubleToBits( ROUNDER ) );
+	exponent &= ~( exponent >> 63 );
+	return p * bitsToDouble( (uint64_t)exponent << 52 );
+}
+
+// |y| well below 2^30
+static inline double cosReduced( double y ) {
+	double shifted = y * 0.63661977236758134 + ROUNDER;
+	double q = shifted - ROUNDER;
+	uint64_t quadrant = doubleToBits( shifted ) & 3;
+	double r = y - q * 1.57079632673412561417e+00 - q * 6.07710050650619224932e-11;
+	double r2 = r * r;
+	double c = 1.0 / 20922789888000.0;
+	c = c * r2 - 1.0 / 87178291200.0;
+	c = c * r2 + 1.0 / 479001600.0;
+	c = c * r2 - 1.0 / 3628800.0;
+	c = c * r2 + 1.0 / 40320.0;
+	c = c * r2 - 1.0 / 720.0;
+	c = c * r2 + 1.0 / 24.0;
+	c = c * r2 - 0.5;
+	c = c * r2 + 1.0;
+	double s = 1.0 / 355687428096000.0;
+	s = s * r2 - 1.0 / 1307674368000.0;
+	s = s * r2 + 1.0 / 6227020800.0;
+	s = s * r2 - 1.0 / 39916800.0;
+	s = s * r2 + 1.0 / 362880.0;
+	s = s * r2 - 1.0 / 5040.0;
+	s = s * r2 + 1.0 / 120.0;
+	s = s * r2 - 1.0 / 6.0;
+	s = s * r2 * r + r;
+	// cos( r + q pi/2 ) = c, -s, -c, s; selected bitwise to stay branch free
+	uint64_t useSine = 0 - ( quadrant & 1 );
+	uint64_t bits = ( doubleToBits( s ) & useSine ) | ( doubleToBits( c ) & ~useSine );
+	return bitsToDouble( bits ^ ( ( ( quadrant + 1 ) & 2 ) << 62 ) );
+}
 
 MyForce::MyForce() {
 }
@@ -17,3 +106,79 @@ MyForce::~MyForce() {
 double MyForce::value( double x ) {
 	return -AMPLITUDE * exp( -x * x * DECAY ) * cos( x / LENGTH );
 }
+
+// float versions of the two above, shorter polynomials
+// z <= 0; flushes to 0 below about -69 already, so that the products taken
+// with the result downstream do not turn subnormal (those are slower by two
+// orders of magnitude). z is clamped first: once z * log2(e) stops being
+// small against ROUNDER_F, k and the exponent bits come out wrong (8e-20 at
+// a distance of 5500, -7e22 at 6000)
+static inline float expNonPositiveF( float z ) {
+	z = z > -87.0f ? z : -87.0f;
+	float shifted = z * 1.44269504f + ROUNDER_F;
+	float k = shifted - ROUNDER_F;
+	float r = z - k * 0.693145751953125f - k * 1.42860677e-06f;
+	float p = 1.0f / 5040.0f;
+	p = p * r + 1.0f / 720.0f;
+	p = p * r + 1.0f / 120.0f;
+	p = p * r + 1.0f / 24.0f;
+	p = p * r + 1.0f / 6.0f;
+	p = p * r + 0.5f;
+	p = p * r + 1.0f;
+	p = p * r + 1.0f;
+	int32_t exponent = (int32_t)( floatToBits( k + 127.0f + ROUNDER_F ) - floatToBits( ROUNDER_F ) );
+	exponent &= ~( ( exponent - 27 ) >> 31 );
+	return p * bitsToFloat( (uint32_t)exponent << 23 );
+}
+
+// |y| below about 2^12, pi / 2 in three parts
+static inline float cosReducedF( float y ) {
+	float shifted = y * 0.636619772f + ROUNDER_F;
+	float q = shifted - ROUNDER_F;
+	uint32_t quadrant = floatToBits( shifted ) & 3;
+	float r = y - q * 1.5703125f - q * 4.83751297e-04f - q * 7.54978995e-08f;
+	float r2 = r * r;
+	float c = 1.0f / 40320.0f;
+	c = c * r2 - 1.0f / 720.0f;
+	c = c * r2 + 1.0f / 24.0f;
+	c = c * r2 - 0.5f;
+	c = c * r2 + 1.0f;
+	float s = 1.0f / 362880.0f;
+	s = s * r2 - 1.0f / 5040.0f;
+	s = s * r2 + 1.0f / 120.0f;
+	s = s * r2 - 1.0f / 6.0f;
+	s = s * r2 * r + r;
+	uint32_t useSine = 0 - ( quadrant & 1 );
+	uint32_t bits = ( floatToBits( s ) & useSine ) | ( floatToBits( c ) & ~useSine );
+	return bitsToFloat( bits ^ ( ( ( quadrant + 1 ) & 2 ) << 30 ) );
+}
+
+// one clone per instruction set, picked when the program loads (virtual
+// functions cannot be cloned themselves)
+__attribute__(( target_clones( "avx512f", "avx2", "default" ) ))
+static void batch( const double *distances, double *forces, int n,
+		double amplitude, double decay, double length ) {
+#pragma omp simd
+	for ( int i = 0; i < n; i++ ) {
+		double x = distances[ i ];
+		forces[ i ] = -amplitude * expNonPositive( -x * x * decay ) * cosReduced( x / length );
+	}
+}
+
+__attribute__(( target_clones( "avx512f", "avx2", "default" ) ))
+static void batchSingle( const float *distances, float *forces, int n,
+		float amplitude, float decay, float length ) {
+#pragma omp simd
+	for ( int i = 0; i < n; i++ ) {
+		float x = distances[ i ];
+		forces[ i ] = -amplitude * expNonPositiveF( -x * x * decay ) * cosReducedF( x / length );
+	}
+}
+
+void MyForce::values( const double *distances, double *forces, int n ) {
+	batch( distances, forces, n, AMPLITUDE, DECAY, LENGTH );
+}
+
+void MyForce::valuesSingle( const float *distances, float *forces, int n ) {
+	batchSingle( distances, forces, n, AMPLITUDE, DECAY, LENGTH );
+}
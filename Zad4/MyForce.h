@@ -19,6 +19,10 @@ public:
 	MyForce();
 
 	double value( double x );
+	// polynomial exp and cos, within a few ulp of value
+	void values( const double *distances, double *forces, int n );
+	// the same in float, to about 1e-7 relative
+	void valuesSingle( const float *distances, float *forces, int n );
 
 	virtual ~MyForce();
 };
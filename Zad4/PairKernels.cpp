@@ -0,0 +1,418 @@
+/*
+ * PairKernels.cpp
+ */
+
+#include "PairKernels.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PAIR_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+static void distancesScalar(const double *x, const double *y, const int *partner, int n,
+                            double xi, double yi, double cutoffSQ,
+                            double *dx, double *dy, double *distance, double *inverse)
+{
+    for (int k = 0; k < n; k++)
+    {
+        dx[k] = x[partner[k]] - xi;
+        dy[k] = y[partner[k]] - yi;
+        double distanceSQ = dx[k] * dx[k] + dy[k] * dy[k];
+        bool inRange = distanceSQ < cutoffSQ && distanceSQ > 0.0;
+        distance[k] = inRange ? sqrt(distanceSQ) : 1.0;
+        inverse[k] = inRange ? 1.0 / distance[k] : 0.0;
+    }
+}
+
+static void distancesSingleScalar(const float *x, const float *y, const int *partner, int n,
+                                  float xi, float yi, float cutoffSQ,
+                                  float *dx, float *dy, float *distance, float *inverse)
+{
+    for (int k = 0; k < n; k++)
+    {
+        dx[k] = x[partner[k]] - xi;
+        dy[k] = y[partner[k]] - yi;
+        float distanceSQ = dx[k] * dx[k] + dy[k] * dy[k];
+        bool inRange = distanceSQ < cutoffSQ && distanceSQ > 0.0f;
+        distance[k] = inRange ? sqrtf(distanceSQ) : 1.0f;
+        inverse[k] = inRange ? 1.0f / distance[k] : 0.0f;
+    }
+}
+
+// columns k .. n of the register-blocked kernels
+static void blockScalarFrom(int k, const double *x, const double *y, int n, const double *xi, const double *yi,
+                            double *dx, double *dy, double *distance, double *inverse)
+{
+    for (; k < n; k++)
+        for (int r = 0; r < DISTANCE_BLOCK; r++)
+        {
+            int at = r * n + k;
+            dx[at] = x[k] - xi[r];
+            dy[at] = y[k] - yi[r];
+            double distanceSQ = dx[at] * dx[at] + dy[at] * dy[at];
+            bool inRange = distanceSQ > 0.0;
+            distance[at] = inRange ? sqrt(distanceSQ) : 1.0;
+            inverse[at] = inRange ? 1.0 / distance[at] : 0.0;
+        }
+}
+
+static void blockScalar(const double *x, const double *y, int n, const double *xi, const double *yi,
+                        double *dx, double *dy, double *distance, double *inverse)
+{
+    blockScalarFrom(0, x, y, n, xi, yi, dx, dy, distance, inverse);
+}
+
+#ifdef PAIR_KERNELS_X86
+
+// the float estimate is good to 12 bits, three steps take it past 53
+__attribute__((target("sse2"))) static void distancesSse2(const double *x, const double *y, const int *partner, int n,
+                                                          double xi, double yi, double cutoffSQ,
+                                                          double *dx, double *dy, double *distance, double *inverse)
+{
+    const __m128d xiv = _mm_set1_pd(xi), yiv = _mm_set1_pd(yi), cut = _mm_set1_pd(cutoffSQ);
+    const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+    const __m128d half = _mm_set1_pd(0.5), threeHalves = _mm_set1_pd(1.5);
+    const __m128 tiny = _mm_set1_ps(1.17549435e-38f);
+    int k = 0;
+    for (; k + 2 <= n; k += 2)
+    {
+        __m128d ddx = _mm_sub_pd(_mm_set_pd(x[partner[k + 1]], x[partner[k]]), xiv);
+        __m128d ddy = _mm_sub_pd(_mm_set_pd(y[partner[k + 1]], y[partner[k]]), yiv);
+        __m128d distanceSQ = _mm_add_pd(_mm_mul_pd(ddx, ddx), _mm_mul_pd(ddy, ddy));
+        __m128d inRange = _mm_and_pd(_mm_cmplt_pd(distanceSQ, cut), _mm_cmpgt_pd(distanceSQ, zero));
+        distanceSQ = _mm_or_pd(_mm_and_pd(inRange, distanceSQ), _mm_andnot_pd(inRange, one));
+        __m128d r = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_max_ps(_mm_cvtpd_ps(distanceSQ), tiny)));
+        __m128d h = _mm_mul_pd(half, distanceSQ);
+        for (int i = 0; i < 3; i++)
+            r = _mm_mul_pd(r, _mm_sub_pd(threeHalves, _mm_mul_pd(h, _mm_mul_pd(r, r))));
+        _mm_storeu_pd(dx + k, ddx);
+        _mm_storeu_pd(dy + k, ddy);
+        _mm_storeu_pd(distance + k, _mm_mul_pd(distanceSQ, r));
+        _mm_storeu_pd(inverse + k, _mm_and_pd(inRange, r));
+    }
+    distancesScalar(x, y, partner + k, n - k, xi, yi, cutoffSQ, dx + k, dy + k, distance + k, inverse + k);
+}
+
+__attribute__((target("avx2,fma"))) static void distancesAvx2(const double *x, const double *y, const int *partner, int n,
+                                                              double xi, double yi, double cutoffSQ,
+                                                              double *dx, double *dy, double *distance, double *inverse)
+{
+    const __m256d xiv = _mm256_set1_pd(xi), yiv = _mm256_set1_pd(yi), cut = _mm256_set1_pd(cutoffSQ);
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+    const __m256d half = _mm256_set1_pd(0.5), threeHalves = _mm256_set1_pd(1.5);
+    const __m128 tiny = _mm_set1_ps(1.17549435e-38f);
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    int k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        __m128i index = _mm_loadu_si128((const __m128i *)(partner + k));
+        __m256d ddx = _mm256_sub_pd(_mm256_mask_i32gather_pd(zero, x, index, all, 8), xiv);
+        __m256d ddy = _mm256_sub_pd(_mm256_mask_i32gather_pd(zero, y, index, all, 8), yiv);
+        __m256d distanceSQ = _mm256_fmadd_pd(ddx, ddx, _mm256_mul_pd(ddy, ddy));
+        __m256d inRange = _mm256_and_pd(_mm256_cmp_pd(distanceSQ, cut, _CMP_LT_OQ),
+                                        _mm256_cmp_pd(distanceSQ, zero, _CMP_GT_OQ));
+        distanceSQ = _mm256_blendv_pd(one, distanceSQ, inRange);
+        __m256d r = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm_max_ps(_mm256_cvtpd_ps(distanceSQ), tiny)));
+        __m256d h = _mm256_mul_pd(half, distanceSQ);
+        for (int i = 0; i < 3; i++)
+            r = _mm256_mul_pd(r, _mm256_fnmadd_pd(h, _mm256_mul_pd(r, r), threeHalves));
+        _mm256_storeu_pd(dx + k, ddx);
+        _mm256_storeu_pd(dy + k, ddy);
+        _mm256_storeu_pd(distance + k, _mm256_mul_pd(distanceSQ, r));
+        _mm256_storeu_pd(inverse + k, _mm256_and_pd(inRange, r));
+    }
+    distancesScalar(x, y, partner + k, n - k, xi, yi, cutoffSQ, dx + k, dy + k, distance + k, inverse + k);
+}
+
+// rsqrt14 needs two steps only
+__attribute__((target("avx512f"))) static void distancesAvx512(const double *x, const double *y, const int *partner, int n,
+                                                               double xi, double yi, double cutoffSQ,
+                                                               double *dx, double *dy, double *distance, double *inverse)
+{
+    const __m512d xiv = _mm512_set1_pd(xi), yiv = _mm512_set1_pd(yi), cut = _mm512_set1_pd(cutoffSQ);
+    const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0);
+    const __m512d half = _mm512_set1_pd(0.5), threeHalves = _mm512_set1_pd(1.5);
+    int k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        __m256i index = _mm256_loadu_si256((const __m256i *)(partner + k));
+        __m512d ddx = _mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xFF, index, x, 8), xiv);
+        __m512d ddy = _mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xFF, index, y, 8), yiv);
+        __m512d distanceSQ = _mm512_fmadd_pd(ddx, ddx, _mm512_mul_pd(ddy, ddy));
+        __mmask8 inRange = _mm512_cmp_pd_mask(distanceSQ, cut, _CMP_LT_OQ)
+                         & _mm512_cmp_pd_mask(distanceSQ, zero, _CMP_GT_OQ);
+        distanceSQ = _mm512_mask_blend_pd(inRange, one, distanceSQ);
+        __m512d r = _mm512_maskz_rsqrt14_pd(0xFF, distanceSQ);
+        __m512d h = _mm512_mul_pd(half, distanceSQ);
+        for (int i = 0; i < 2; i++)
+            r = _mm512_mul_pd(r, _mm512_fnmadd_pd(h, _mm512_mul_pd(r, r), threeHalves));
+        _mm512_storeu_pd(dx + k, ddx);
+        _mm512_storeu_pd(dy + k, ddy);
+        _mm512_storeu_pd(distance + k, _mm512_mul_pd(distanceSQ, r));
+        _mm512_storeu_pd(inverse + k, _mm512_maskz_mov_pd(inRange, r));
+    }
+    distancesScalar(x, y, partner + k, n - k, xi, yi, cutoffSQ, dx + k, dy + k, distance + k, inverse + k);
+}
+
+__attribute__((target("sse2"))) static void distancesSingleSse2(const float *x, const float *y, const int *partner, int n,
+                                                                float xi, float yi, float cutoffSQ,
+                                                                float *dx, float *dy, float *distance, float *inverse)
+{
+    const __m128 xiv = _mm_set1_ps(xi), yiv = _mm_set1_ps(yi), cut = _mm_set1_ps(cutoffSQ);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    int k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        const int *p = partner + k;
+        __m128 ddx = _mm_sub_ps(_mm_set_ps(x[p[3]], x[p[2]], x[p[1]], x[p[0]]), xiv);
+        __m128 ddy = _mm_sub_ps(_mm_set_ps(y[p[3]], y[p[2]], y[p[1]], y[p[0]]), yiv);
+        __m128 distanceSQ = _mm_add_ps(_mm_mul_ps(ddx, ddx), _mm_mul_ps(ddy, ddy));
+        __m128 inRange = _mm_and_ps(_mm_cmplt_ps(distanceSQ, cut), _mm_cmpgt_ps(distanceSQ, zero));
+        __m128 d = _mm_sqrt_ps(_mm_or_ps(_mm_and_ps(inRange, distanceSQ), _mm_andnot_ps(inRange, one)));
+        _mm_storeu_ps(dx + k, ddx);
+        _mm_storeu_ps(dy + k, ddy);
+        _mm_storeu_ps(distance + k, d);
+        _mm_storeu_ps(inverse + k, _mm_and_ps(inRange, _mm_div_ps(one, d)));
+    }
+    distancesSingleScalar(x, y, partner + k, n - k, xi, yi, cutoffSQ, dx + k, dy + k, distance + k, inverse + k);
+}
+
+__attribute__((target("avx2,fma"))) static void distancesSingleAvx2(const float *x, const float *y, const int *partner, int n,
+                                                                    float xi, float yi, float cutoffSQ,
+                                                                    float *dx, float *dy, float *distance, float *inverse)
+{
+    const __m256 xiv = _mm256_set1_ps(xi), yiv = _mm256_set1_ps(yi), cut = _mm256_set1_ps(cutoffSQ);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    int k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        __m256i index = _mm256_loadu_si256((const __m256i *)(partner + k));
+        __m256 ddx = _mm256_sub_ps(_mm256_mask_i32gather_ps(zero, x, index, all, 4), xiv);
+        __m256 ddy = _mm256_sub_ps(_mm256_mask_i32gather_ps(zero, y, index, all, 4), yiv);
+        __m256 distanceSQ = _mm256_fmadd_ps(ddx, ddx, _mm256_mul_ps(ddy, ddy));
+        __m256 inRange = _mm256_and_ps(_mm256_cmp_ps(distanceSQ, cut, _CMP_LT_OQ),
+                                       _mm256_cmp_ps(distanceSQ, zero, _CMP_GT_OQ));
+        __m256 d = _mm256_sqrt_ps(_mm256_blendv_ps(one, distanceSQ, inRange));
+        _mm256_storeu_ps(dx + k, ddx);
+        _mm256_storeu_ps(dy + k, ddy);
+        _mm256_storeu_ps(distance + k, d);
+        _mm256_storeu_ps(inverse + k, _mm256_and_ps(inRange, _mm256_div_ps(one, d)));
+    }
+    distancesSingleScalar(x, y, partner + k, n - k, xi, yi, cutoffSQ, dx + k, dy + k, distance + k, inverse + k);
+}
+
+__attribute__((target("avx512f"))) static void distancesSingleAvx512(const float *x, const float *y, const int *partner, int n,
+                                                                     float xi, float yi, float cutoffSQ,
+                                                                     float *dx, float *dy, float *distance, float *inverse)
+{
+    const __m512 xiv = _mm512_set1_ps(xi), yiv = _mm512_set1_ps(yi), cut = _mm512_set1_ps(cutoffSQ);
+    const __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1.0f);
+    int k = 0;
+    for (; k + 16 <= n; k += 16)
+    {
+        __m512i index = _mm512_loadu_si512((const void *)(partner + k));
+        __m512 ddx = _mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xFFFF, index, x, 4), xiv);
+        __m512 ddy = _mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xFFFF, index, y, 4), yiv);
+        __m512 distanceSQ = _mm512_fmadd_ps(ddx, ddx, _mm512_mul_ps(ddy, ddy));
+        __mmask16 inRange = _mm512_cmp_ps_mask(distanceSQ, cut, _CMP_LT_OQ)
+                          & _mm512_cmp_ps_mask(distanceSQ, zero, _CMP_GT_OQ);
+        __m512 d = _mm512_maskz_sqrt_ps(0xFFFF, _mm512_mask_blend_ps(inRange, one, distanceSQ));
+        _mm512_storeu_ps(dx + k, ddx);
+        _mm512_storeu_ps(dy + k, ddy);
+        _mm512_storeu_ps(distance + k, d);
+        _mm512_storeu_ps(inverse + k, _mm512_maskz_div_ps(inRange, one, d));
+    }
+    distancesSingleScalar(x, y, partner + k, n - k, xi, yi, cutoffSQ, dx + k, dy + k, distance + k, inverse + k);
+}
+
+// one partner vector against one of the particles of the blocked kernels,
+// the same steps as the gathering kernels above
+__attribute__((target("sse2"))) static inline void blockRowSse2(__m128d xk, __m128d yk, __m128d xi, __m128d yi,
+                                                                double *dx, double *dy, double *distance,
+                                                                double *inverse)
+{
+    const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+    const __m128d half = _mm_set1_pd(0.5), threeHalves = _mm_set1_pd(1.5);
+    __m128d ddx = _mm_sub_pd(xk, xi);
+    __m128d ddy = _mm_sub_pd(yk, yi);
+    __m128d distanceSQ = _mm_add_pd(_mm_mul_pd(ddx, ddx), _mm_mul_pd(ddy, ddy));
+    __m128d inRange = _mm_cmpgt_pd(distanceSQ, zero);
+    distanceSQ = _mm_or_pd(_mm_and_pd(inRange, distanceSQ), _mm_andnot_pd(inRange, one));
+    __m128d r = _mm_cvtps_pd(_mm_rsqrt_ps(_mm_max_ps(_mm_cvtpd_ps(distanceSQ), _mm_set1_ps(1.17549435e-38f))));
+    __m128d h = _mm_mul_pd(half, distanceSQ);
+    for (int i = 0; i < 3; i++)
+        r = _mm_mul_pd(r, _mm_sub_pd(threeHalves, _mm_mul_pd(h, _mm_mul_pd(r, r))));
+    _mm_storeu_pd(dx, ddx);
+    _mm_storeu_pd(dy, ddy);
+    _mm_storeu_pd(distance, _mm_mul_pd(distanceSQ, r));
+    _mm_storeu_pd(inverse, _mm_and_pd(inRange, r));
+}
+
+__attribute__((target("sse2"))) static void blockSse2(const double *x, const double *y, int n, const double *xi,
+                                                      const double *yi, double *dx, double *dy, double *distance,
+                                                      double *inverse)
+{
+    const __m128d xi0 = _mm_set1_pd(xi[0]), xi1 = _mm_set1_pd(xi[1]), xi2 = _mm_set1_pd(xi[2]), xi3 = _mm_set1_pd(xi[3]);
+    const __m128d yi0 = _mm_set1_pd(yi[0]), yi1 = _mm_set1_pd(yi[1]), yi2 = _mm_set1_pd(yi[2]), yi3 = _mm_set1_pd(yi[3]);
+    int k = 0;
+    for (; k + 2 <= n; k += 2)
+    {
+        __m128d xk = _mm_loadu_pd(x + k), yk = _mm_loadu_pd(y + k);
+        blockRowSse2(xk, yk, xi0, yi0, dx + k, dy + k, distance + k, inverse + k);
+        blockRowSse2(xk, yk, xi1, yi1, dx + n + k, dy + n + k, distance + n + k, inverse + n + k);
+        blockRowSse2(xk, yk, xi2, yi2, dx + 2 * n + k, dy + 2 * n + k, distance + 2 * n + k, inverse + 2 * n + k);
+        blockRowSse2(xk, yk, xi3, yi3, dx + 3 * n + k, dy + 3 * n + k, distance + 3 * n + k, inverse + 3 * n + k);
+    }
+    blockScalarFrom(k, x, y, n, xi, yi, dx, dy, distance, inverse);
+}
+
+__attribute__((target("avx2,fma"))) static inline void blockRowAvx2(__m256d xk, __m256d yk, __m256d xi, __m256d yi,
+                                                                    double *dx, double *dy, double *distance,
+                                                                    double *inverse)
+{
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+    const __m256d half = _mm256_set1_pd(0.5), threeHalves = _mm256_set1_pd(1.5);
+    __m256d ddx = _mm256_sub_pd(xk, xi);
+    __m256d ddy = _mm256_sub_pd(yk, yi);
+    __m256d distanceSQ = _mm256_fmadd_pd(ddx, ddx, _mm256_mul_pd(ddy, ddy));
+    __m256d inRange = _mm256_cmp_pd(distanceSQ, zero, _CMP_GT_OQ);
+    distanceSQ = _mm256_blendv_pd(one, distanceSQ, inRange);
+    __m256d r = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm_max_ps(_mm256_cvtpd_ps(distanceSQ), _mm_set1_ps(1.17549435e-38f))));
+    __m256d h = _mm256_mul_pd(half, distanceSQ);
+    for (int i = 0; i < 3; i++)
+        r = _mm256_mul_pd(r, _mm256_fnmadd_pd(h, _mm256_mul_pd(r, r), threeHalves));
+    _mm256_storeu_pd(dx, ddx);
+    _mm256_storeu_pd(dy, ddy);
+    _mm256_storeu_pd(distance, _mm256_mul_pd(distanceSQ, r));
+    _mm256_storeu_pd(inverse, _mm256_and_pd(inRange, r));
+}
+
+__attribute__((target("avx2,fma"))) static void blockAvx2(const double *x, const double *y, int n, const double *xi,
+                                                          const double *yi, double *dx, double *dy, double *distance,
+                                                          double *inverse)
+{
+    const __m256d xi0 = _mm256_set1_pd(xi[0]), xi1 = _mm256_set1_pd(xi[1]);
+    const __m256d xi2 = _mm256_set1_pd(xi[2]), xi3 = _mm256_set1_pd(xi[3]);
+    const __m256d yi0 = _mm256_set1_pd(yi[0]), yi1 = _mm256_set1_pd(yi[1]);
+    const __m256d yi2 = _mm256_set1_pd(yi[2]), yi3 = _mm256_set1_pd(yi[3]);
+    int k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        __m256d xk = _mm256_loadu_pd(x + k), yk = _mm256_loadu_pd(y + k);
+        blockRowAvx2(xk, yk, xi0, yi0, dx + k, dy + k, distance + k, inverse + k);
+        blockRowAvx2(xk, yk, xi1, yi1, dx + n + k, dy + n + k, distance + n + k, inverse + n + k);
+        blockRowAvx2(xk, yk, xi2, yi2, dx + 2 * n + k, dy + 2 * n + k, distance + 2 * n + k, inverse + 2 * n + k);
+        blockRowAvx2(xk, yk, xi3, yi3, dx + 3 * n + k, dy + 3 * n + k, distance + 3 * n + k, inverse + 3 * n + k);
+    }
+    blockScalarFrom(k, x, y, n, xi, yi, dx, dy, distance, inverse);
+}
+
+__attribute__((target("avx512f"))) static inline void blockRowAvx512(__m512d xk, __m512d yk, __m512d xi, __m512d yi,
+                                                                     double *dx, double *dy, double *distance,
+                                                                     double *inverse)
+{
+    const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0);
+    const __m512d half = _mm512_set1_pd(0.5), threeHalves = _mm512_set1_pd(1.5);
+    __m512d ddx = _mm512_sub_pd(xk, xi);
+    __m512d ddy = _mm512_sub_pd(yk, yi);
+    __m512d distanceSQ = _mm512_fmadd_pd(ddx, ddx, _mm512_mul_pd(ddy, ddy));
+    __mmask8 inRange = _mm512_cmp_pd_mask(distanceSQ, zero, _CMP_GT_OQ);
+    distanceSQ = _mm512_mask_blend_pd(inRange, one, distanceSQ);
+    __m512d r = _mm512_maskz_rsqrt14_pd(0xFF, distanceSQ);
+    __m512d h = _mm512_mul_pd(half, distanceSQ);
+    for (int i = 0; i < 2; i++)
+        r = _mm512_mul_pd(r, _mm512_fnmadd_pd(h, _mm512_mul_pd(r, r), threeHalves));
+    _mm512_storeu_pd(dx, ddx);
+    _mm512_storeu_pd(dy, ddy);
+    _mm512_storeu_pd(distance, _mm512_mul_pd(distanceSQ, r));
+    _mm512_storeu_pd(inverse, _mm512_maskz_mov_pd(inRange, r));
+}
+
+__attribute__((target("avx512f"))) static void blockAvx512(const double *x, const double *y, int n, const double *xi,
+                                                           const double *yi, double *dx, double *dy, double *distance,
+                                                           double *inverse)
+{
+    const __m512d xi0 = _mm512_set1_pd(xi[0]), xi1 = _mm512_set1_pd(xi[1]);
+    const __m512d xi2 = _mm512_set1_pd(xi[2]), xi3 = _mm512_set1_pd(xi[3]);
+    const __m512d yi0 = _mm512_set1_pd(yi[0]), yi1 = _mm512_set1_pd(yi[1]);
+    const __m512d yi2 = _mm512_set1_pd(yi[2]), yi3 = _mm512_set1_pd(yi[3]);
+    int k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        __m512d xk = _mm512_loadu_pd(x + k), yk = _mm512_loadu_pd(y + k);
+        blockRowAvx512(xk, yk, xi0, yi0, dx + k, dy + k, distance + k, inverse + k);
+        blockRowAvx512(xk, yk, xi1, yi1, dx + n + k, dy + n + k, distance + n + k, inverse + n + k);
+        blockRowAvx512(xk, yk, xi2, yi2, dx + 2 * n + k, dy + 2 * n + k, distance + 2 * n + k, inverse + 2 * n + k);
+        blockRowAvx512(xk, yk, xi3, yi3, dx + 3 * n + k, dy + 3 * n + k, distance + 3 * n + k, inverse + 3 * n + k);
+    }
+    blockScalarFrom(k, x, y, n, xi, yi, dx, dy, distance, inverse);
+}
+
+#endif
+
+struct NamedKernel
+{
+    const char *name;
+    DistanceKernel kernel;
+    DistanceKernelSingle kernelSingle;
+    DistanceBlockKernel blockKernel;
+    bool (*supported)();
+};
+
+static bool always() { return true; }
+
+#ifdef PAIR_KERNELS_X86
+static bool hasSse2() { return __builtin_cpu_supports("sse2"); }
+static bool hasAvx2() { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"); }
+static bool hasAvx512() { return __builtin_cpu_supports("avx512f"); }
+#endif
+
+// widest first, so that "auto" takes the first one supported
+static const NamedKernel KERNELS[] = {
+#ifdef PAIR_KERNELS_X86
+    {"avx512", distancesAvx512, distancesSingleAvx512, blockAvx512, hasAvx512},
+    {"avx2", distancesAvx2, distancesSingleAvx2, blockAvx2, hasAvx2},
+    {"sse2", distancesSse2, distancesSingleSse2, blockSse2, hasSse2},
+#endif
+    {"scalar", distancesScalar, distancesSingleScalar, blockScalar, always},
+};
+static const int KERNEL_COUNT = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+static const NamedKernel *find(const char *name)
+{
+    bool best = strcmp(name, "auto") == 0;
+    for (int i = 0; i < KERNEL_COUNT; i++)
+        if ((best || strcmp(name, KERNELS[i].name) == 0) && KERNELS[i].supported())
+            return &KERNELS[i];
+    return 0;
+}
+
+DistanceKernel selectDistanceKernel(const char *name)
+{
+    const NamedKernel *found = find(name);
+    return found ? found->kernel : 0;
+}
+
+DistanceKernelSingle selectDistanceKernelSingle(const char *name)
+{
+    const NamedKernel *found = find(name);
+    return found ? found->kernelSingle : 0;
+}
+
+DistanceBlockKernel selectDistanceBlockKernel(const char *name)
+{
+    const NamedKernel *found = find(name);
+    return found ? found->blockKernel : 0;
+}
+
+const char *distanceKernelName(DistanceKernel kernel)
+{
+    for (int i = 0; i < KERNEL_COUNT; i++)
+        if (KERNELS[i].kernel == kernel)
+            return KERNELS[i].name;
+    return "unknown";
+}
@@ -0,0 +1,39 @@
+/*
+ * PairKernels.h
+ */
+
+#ifndef PAIRKERNELS_H_
+#define PAIRKERNELS_H_
+
+// First stage of the batched pair loop: for partners partner[0 .. n) of the
+// particle at (xi, yi) it stores dx, dy, the distance and the weighted
+// inverse distance, 0 for partners at or beyond sqrt(cutoffSQ) and for the
+// particle itself (distance 1 there, so forces stay finite). The SIMD
+// versions take rsqrt and Newton steps instead of sqrt and a division and
+// agree with the scalar one to a few ulp for squared distances above ~1e-38.
+typedef void (*DistanceKernel)(const double *x, const double *y, const int *partner, int n,
+                               double xi, double yi, double cutoffSQ,
+                               double *dx, double *dy, double *distance, double *inverse);
+
+// The same in float, for the MIXED and SINGLE precisions of Simulation;
+// sqrt and division are exact here, they cost little in float.
+typedef void (*DistanceKernelSingle)(const float *x, const float *y, const int *partner, int n,
+                                     float xi, float yi, float cutoffSQ,
+                                     float *dx, float *dy, float *distance, float *inverse);
+
+// All pairs, register blocked: the partners are x[0 .. n), y[0 .. n)
+// themselves, each loaded once with a contiguous load and taken against the
+// DISTANCE_BLOCK particles at xi[], yi[], which stay in registers. Row r of
+// every output starts at r * n; no cutoff, otherwise as above.
+constexpr int DISTANCE_BLOCK = 4;
+typedef void (*DistanceBlockKernel)(const double *x, const double *y, int n, const double *xi, const double *yi,
+                                    double *dx, double *dy, double *distance, double *inverse);
+
+// "scalar", "sse2", "avx2", "avx512" or "auto" for the widest the CPU runs;
+// NULL for unknown names and instruction sets the CPU lacks
+DistanceKernel selectDistanceKernel(const char *name);
+DistanceKernelSingle selectDistanceKernelSingle(const char *name);
+DistanceBlockKernel selectDistanceBlockKernel(const char *name);
+const char *distanceKernelName(DistanceKernel kernel);
+
+#endif /* PAIRKERNELS_H_ */
@@ -15,6 +15,11 @@
 
 using namespace std;
 
+// partners per Force::values call, small enough for the buffers to sit in L1
+static constexpr int PAIR_CHUNK = 128;
+// tiled all-pairs: particles per block at most
+static constexpr int TILE_BLOCK = 256;
+
 Simulation::Simulation(Force *_force, double _dt, bool _molecularStatic)
 {
     force = _force;
@@ -24,6 +29,117 @@ Simulation::Simulation(Force *_force, double _dt, bool _molecularStatic)
     dt = _dt;
     dt_2 = dt / 2.0;
     molecularStatic = _molecularStatic;
+    cutoff = 0.0;
+    skin = 0.0;
+    halfPairs = false;
+    binStride = 0;
+    batched = false;
+    distanceKernel = selectDistanceKernel("auto");
+    distanceKernelSingle = selectDistanceKernelSingle("auto");
+    distanceBlockKernel = selectDistanceBlockKernel("auto");
+    precision = DOUBLE;
+    tileSize = 0;
+    reorderEvery = 0;
+    reorderCountdown = 0;
+}
+
+void Simulation::setReorderEvery(int every)
+{
+    reorderEvery = every > 0 ? every : 0;
+    reorderCountdown = 0;
+}
+
+const int *Simulation::particleIds()
+{
+    return ids.data();
+}
+
+// gathers through the order; the Verlet lists refer to the old slots
+void Simulation::reorder()
+{
+    morton.build(x, y, particles);
+    const int *order = morton.order();
+    double *arrays[] = {x, y, m, Vx, Vy, Fx, Fy};
+    for (double *values : arrays)
+        permute(values, order);
+
+    std::vector<int> oldIds(ids);
+#pragma omp parallel for
+    for (int k = 0; k < particles; k++)
+        ids[k] = oldIds[order[k]];
+    verlet.invalidate();
+}
+
+void Simulation::permute(double *values, const int *order)
+{
+    reorderScratch.resize(particles);
+#pragma omp parallel
+    {
+#pragma omp for
+        for (int k = 0; k < particles; k++)
+            reorderScratch[k] = values[order[k]];
+#pragma omp for
+        for (int k = 0; k < particles; k++)
+            values[k] = reorderScratch[k];
+    }
+}
+
+void Simulation::setTileSize(int _tileSize)
+{
+    tileSize = _tileSize > 0 ? _tileSize : 0;
+}
+
+void Simulation::setPrecision(Precision _precision)
+{
+    precision = _precision;
+}
+
+bool Simulation::setPairKernel(const char *name)
+{
+    DistanceKernel kernel = selectDistanceKernel(name);
+    if (!kernel)
+        return false;
+    distanceKernel = kernel;
+    distanceKernelSingle = selectDistanceKernelSingle(name);
+    distanceBlockKernel = selectDistanceBlockKernel(name);
+    return true;
+}
+
+const char *Simulation::pairKernelName()
+{
+    return distanceKernelName(distanceKernel);
+}
+
+void Simulation::setBatched(bool _batched)
+{
+    batched = _batched;
+}
+
+void Simulation::setHalfPairs(bool _halfPairs)
+{
+    halfPairs = _halfPairs;
+}
+
+void Simulation::setCutoff(double _cutoff)
+{
+    cutoff = _cutoff > 0.0 ? _cutoff : 0.0;
+    verlet.setRange(cutoff, skin);
+}
+
+void Simulation::setSkin(double _skin)
+{
+    skin = _skin > 0.0 ? _skin : 0.0;
+    verlet.setRange(cutoff, skin);
+}
+
+long long Simulation::neighbourListBuilds()
+{
+    return verlet.builds();
+}
+
+double Simulation::averageNeighbours()
+{
+    return verlet.averageLength();
 }
 
 void Simulation::initialize(DataSupplier *supplier)
@@ -39,6 +155,9 @@ void Simulation::initialize(DataSupplier *supplier)
         m[idx] = supplier->m(idx);
         Vx[idx] = Vy[idx] = Fx[idx] = Fy[idx] = {0.0};
     }
+    ids.resize(particles);
+    for (int idx = 0; idx < particles; idx++)
+        ids[idx] = idx;
 }
 
 void Simulation::allocateMemory()
@@ -54,50 +173,519 @@ void Simulation::allocateMemory()
 
 void Simulation::step()
 {
-    updateVelocity();
+    if (reorderEvery > 0 && reorderCountdown-- == 0)
+    {
+        reorder();
+        reorderCountdown = reorderEvery - 1;
+    }
+    if (halfPairs)
+        updateVelocityHalf();
+    else if (precision != DOUBLE)
+        updateVelocitySingle();
+    else if (tileSize > 0 && cutoff == 0.0)
+        updateVelocityTiled();
+    else if (batched)
+        updateVelocityBatched();
+    else if (cutoff > 0.0 && skin > 0.0)
+        updateVelocityVerlet();
+    else if (cutoff > 0.0)
+        updateVelocityCutoff();
+    else
+        updateVelocity();
     updatePosition();
     if (molecularStatic)
         preventMoveAgainstForce();
 }
 
 void Simulation::updateVelocity()
+{
+#pragma omp parallel for
+    for (int idx = 0; idx < particles; idx++)
+        updateVelocityOf(idx);
+}
+
+void Simulation::updateVelocityOf(int idx)
 {
     double oldFx, oldFy;
     double dx, dy, distance, frc;
 
-#pragma omp parallel for private(oldFx, oldFy, dx, dy, distance, frc)
+    oldFx = Fx[idx];
+    oldFy = Fy[idx];
+    Fx[idx] = Fy[idx] = 0.0;
+    for (int idx2 = 0; idx2 < idx; idx2++)
+    {
+        dx = x[idx2] - x[idx];
+        dy = y[idx2] - y[idx];
+
+        distance = sqrt(dx * dx + dy * dy);
+
+        frc = force->value(distance);
+
+        Fx[idx] += frc * dx / distance;
+        Fy[idx] += frc * dy / distance;
+    }
+
+    for (int idx2 = idx + 1; idx2 < particles; idx2++)
+    {
+        dx = x[idx2] - x[idx];
+        dy = y[idx2] - y[idx];
+
+        distance = sqrt(dx * dx + dy * dy);
+
+        frc = force->value(distance);
+
+        Fx[idx] += frc * dx / distance;
+        Fy[idx] += frc * dy / distance;
+    }
+    Vx[idx] += dt_2 * (Fx[idx] + oldFx) / m[idx];
+    Vy[idx] += dt_2 * (Fy[idx] + oldFy) / m[idx];
+}
+
+// particles are visited bin by bin, so neighbouring iterations share bins
+void Simulation::updateVelocityCutoff()
+{
+    cells.build(x, y, particles, cutoff);
+    const double cutoffSQ = cutoff * cutoff;
+    const double shift = force->value(cutoff);
+    const int *order = cells.order();
+
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < particles; k++)
+    {
+        int idx = order[k];
+        double oldFx = Fx[idx];
+        double oldFy = Fy[idx];
+        double fx = 0.0, fy = 0.0;
+        int cell = cells.cellOf(idx);
+        int column = cell % cells.columns();
+        int row = cell / cells.columns();
+        int lastColumn = column + 1 < cells.columns() ? column + 1 : column;
+        int lastRow = row + 1 < cells.rows() ? row + 1 : row;
+
+        for (int r = row > 0 ? row - 1 : 0; r <= lastRow; r++)
+            for (int c = column > 0 ? column - 1 : 0; c <= lastColumn; c++)
+            {
+                int neighbour = cells.cell(c, r);
+                for (const int *p = cells.begin(neighbour); p != cells.end(neighbour); p++)
+                {
+                    int idx2 = *p;
+                    double dx = x[idx2] - x[idx];
+                    double dy = y[idx2] - y[idx];
+                    double distanceSQ = dx * dx + dy * dy;
+                    if (distanceSQ >= cutoffSQ || idx2 == idx)
+                        continue;
+                    double distance = sqrt(distanceSQ);
+                    double frc = force->value(distance) - shift;
+                    fx += frc * dx / distance;
+                    fy += frc * dy / distance;
+                }
+            }
+        Fx[idx] = fx;
+        Fy[idx] = fy;
+        Vx[idx] += dt_2 * (Fx[idx] + oldFx) / m[idx];
+        Vy[idx] += dt_2 * (Fy[idx] + oldFy) / m[idx];
+    }
+}
+
+// the lists hold cutoff + skin partners, the cutoff itself is applied here
+void Simulation::updateVelocityVerlet()
+{
+    verlet.update(x, y, particles);
+    const double cutoffSQ = cutoff * cutoff;
+    const double shift = force->value(cutoff);
+
+#pragma omp parallel for schedule(static)
     for (int idx = 0; idx < particles; idx++)
     {
-        oldFx = Fx[idx];
-        oldFy = Fy[idx];
-        Fx[idx] = Fy[idx] = 0.0;
-        for (int idx2 = 0; idx2 < idx; idx2++)
+        double oldFx = Fx[idx];
+        double oldFy = Fy[idx];
+        double fx = 0.0, fy = 0.0;
+        const double xi = x[idx], yi = y[idx];
+        for (const int *p = verlet.begin(idx); p != verlet.end(idx); p++)
+        {
+            double dx = x[*p] - xi;
+            double dy = y[*p] - yi;
+            double distanceSQ = dx * dx + dy * dy;
+            if (distanceSQ >= cutoffSQ)
+                continue;
+            double distance = sqrt(distanceSQ);
+            double frc = force->value(distance) - shift;
+            fx += frc * dx / distance;
+            fy += frc * dy / distance;
+        }
+        Fx[idx] = fx;
+        Fy[idx] = fy;
+        Vx[idx] += dt_2 * (Fx[idx] + oldFx) / m[idx];
+        Vy[idx] += dt_2 * (Fy[idx] + oldFy) / m[idx];
+    }
+}
+
+// lists for the cutoff modes, built or refreshed once per step
+bool Simulation::prepareNeighbours()
+{
+    const bool useVerlet = cutoff > 0.0 && skin > 0.0;
+    if (useVerlet)
+        verlet.update(x, y, particles);
+    else if (cutoff > 0.0)
+        cells.build(x, y, particles, cutoff);
+    else if ((int)allIndices.size() != particles)
+    {
+        allIndices.resize(particles);
+        for (int idx = 0; idx < particles; idx++)
+            allIndices[idx] = idx;
+    }
+    return useVerlet;
+}
+
+// partners of idx as runs of indices: its Verlet list, the 3x3 bins around
+// it or everybody; the cutoff itself is left to the caller
+template <class Visit>
+void Simulation::partnerRanges(int idx, bool useVerlet, Visit visit)
+{
+    if (useVerlet)
+        visit(verlet.begin(idx), verlet.end(idx));
+    else if (cutoff > 0.0)
+    {
+        int cell = cells.cellOf(idx);
+        int column = cell % cells.columns();
+        int row = cell / cells.columns();
+        int lastColumn = column + 1 < cells.columns() ? column + 1 : column;
+        int lastRow = row + 1 < cells.rows() ? row + 1 : row;
+        for (int r = row > 0 ? row - 1 : 0; r <= lastRow; r++)
+            for (int c = column > 0 ? column - 1 : 0; c <= lastColumn; c++)
+                visit(cells.begin(cells.cell(c, r)), cells.end(cells.cell(c, r)));
+    }
+    else
+        visit(allIndices.data(), allIndices.data() + particles);
+}
+
+// partner j > idx only; static schedules keep both the pair-to-thread
+// assignment and the order of the final sum fixed
+void Simulation::updateVelocityHalf()
+{
+    const bool useVerlet = prepareNeighbours();
+    const double cutoffSQ = cutoff > 0.0 ? cutoff * cutoff : INFINITY;
+    const double shift = cutoff > 0.0 ? force->value(cutoff) : 0.0;
+    const int maxThreads = omp_get_max_threads();
+    threadFx.resize((size_t)maxThreads * particles);
+    threadFy.resize((size_t)maxThreads * particles);
+
+#pragma omp parallel
+    {
+        const int threads = omp_get_num_threads();
+        double *fx = threadFx.data() + (size_t)omp_get_thread_num() * particles;
+        double *fy = threadFy.data() + (size_t)omp_get_thread_num() * particles;
+        for (int idx = 0; idx < particles; idx++)
+            fx[idx] = fy[idx] = 0.0;
+
+#pragma omp for schedule(static, 16)
+        for (int idx = 0; idx < particles; idx++)
         {
-            dx = x[idx2] - x[idx];
-            dy = y[idx2] - y[idx];
+            const double xi = x[idx], yi = y[idx];
+            double fxi = 0.0, fyi = 0.0;
+            partnerRanges(idx, useVerlet, [&](const int *begin, const int *end) {
+                for (const int *p = begin; p != end; p++)
+                {
+                    int idx2 = *p;
+                    if (idx2 <= idx)
+                        continue;
+                    double dx = x[idx2] - xi;
+                    double dy = y[idx2] - yi;
+                    double distanceSQ = dx * dx + dy * dy;
+                    if (distanceSQ >= cutoffSQ)
+                        continue;
+                    double distance = sqrt(distanceSQ);
+                    double frc = force->value(distance) - shift;
+                    double fxPair = frc * dx / distance;
+                    double fyPair = frc * dy / distance;
+                    fxi += fxPair;
+                    fyi += fyPair;
+                    fx[idx2] -= fxPair;
+                    fy[idx2] -= fyPair;
+                }
+            });
+            fx[idx] += fxi;
+            fy[idx] += fyi;
+        }
 
-            distance = sqrt(dx * dx + dy * dy);
+#pragma omp for schedule(static)
+        for (int idx = 0; idx < particles; idx++)
+        {
+            double oldFx = Fx[idx];
+            double oldFy = Fy[idx];
+            double sumX = 0.0, sumY = 0.0;
+            for (int t = 0; t < threads; t++)
+            {
+                sumX += threadFx[(size_t)t * particles + idx];
+                sumY += threadFy[(size_t)t * particles + idx];
+            }
+            Fx[idx] = sumX;
+            Fy[idx] = sumY;
+            Vx[idx] += dt_2 * (Fx[idx] + oldFx) / m[idx];
+            Vy[idx] += dt_2 * (Fy[idx] + oldFy) / m[idx];
+        }
+    }
+}
 
-            frc = force->value(distance);
+// sum of (force - shift) / distance * (dx, dy) over a chunk; outside the
+// lambdas below, where captured buffers would keep it from vectorizing
+template <class Real, class Sum>
+static inline void accumulateChunk(const Real *forces, const Real *inverses, const Real *dxs, const Real *dys,
+                                   int n, Real shift, Sum &fx, Sum &fy)
+{
+    Sum sumX = 0, sumY = 0;
+#pragma omp simd reduction(+ : sumX, sumY)
+    for (int k = 0; k < n; k++)
+    {
+        Real frc = (forces[k] - shift) * inverses[k];
+        sumX += frc * dxs[k];
+        sumY += frc * dys[k];
+    }
+    fx += sumX;
+    fy += sumY;
+}
 
-            Fx[idx] += frc * dx / distance;
-            Fy[idx] += frc * dy / distance;
+// per chunk: distances, then forces, then accumulation; partners out of
+// range (and the particle itself) get a dummy distance and a zero inverse
+void Simulation::updateVelocityBatched()
+{
+    const bool useVerlet = prepareNeighbours();
+    const double cutoffSQ = cutoff > 0.0 ? cutoff * cutoff : INFINITY;
+    const double shift = cutoff > 0.0 ? force->value(cutoff) : 0.0;
+
+#pragma omp parallel
+    {
+        double dxs[PAIR_CHUNK], dys[PAIR_CHUNK], inverses[PAIR_CHUNK];
+        double distances[PAIR_CHUNK], forces[PAIR_CHUNK];
+
+#pragma omp for schedule(static)
+        for (int idx = 0; idx < particles; idx++)
+        {
+            const double xi = x[idx], yi = y[idx];
+            double fx = 0.0, fy = 0.0;
+            partnerRanges(idx, useVerlet, [&](const int *begin, const int *end) {
+                for (; begin < end; begin += PAIR_CHUNK)
+                {
+                    int n = end - begin < PAIR_CHUNK ? end - begin : PAIR_CHUNK;
+                    distanceKernel(x, y, begin, n, xi, yi, cutoffSQ, dxs, dys, distances, inverses);
+                    force->values(distances, forces, n);
+                    accumulateChunk(forces, inverses, dxs, dys, n, shift, fx, fy);
+                }
+            });
+
+            double oldFx = Fx[idx];
+            double oldFy = Fy[idx];
+            Fx[idx] = fx;
+            Fy[idx] = fy;
+            Vx[idx] += dt_2 * (Fx[idx] + oldFx) / m[idx];
+            Vy[idx] += dt_2 * (Fy[idx] + oldFy) / m[idx];
         }
+    }
+}
 
-        for (int idx2 = idx + 1; idx2 < particles; idx2++)
+// x and y pass through the cache particles / block times instead of
+// particles times: every tile is visited by a whole block of particles.
+// Within the block DISTANCE_BLOCK particles at a time take every partner
+// of the tile, which is read straight from x and y. Blocks are equally
+// expensive, static scheduling balances them; they shrink when there would
+// be fewer than four per thread.
+void Simulation::updateVelocityTiled()
+{
+    int blockSize = particles / (4 * omp_get_max_threads());
+    blockSize = blockSize < TILE_BLOCK ? blockSize : TILE_BLOCK;
+    blockSize = blockSize > DISTANCE_BLOCK ? blockSize : DISTANCE_BLOCK;
+    const int blocks = (particles + blockSize - 1) / blockSize;
+
+#pragma omp parallel
+    {
+        const size_t group = (size_t)DISTANCE_BLOCK * tileSize;
+        std::vector<double> dxs(group), dys(group), distances(group), inverses(group), forces(group);
+        double fx[TILE_BLOCK], fy[TILE_BLOCK];
+
+#pragma omp for schedule(static)
+        for (int block = 0; block < blocks; block++)
         {
-            dx = x[idx2] - x[idx];
-            dy = y[idx2] - y[idx];
+            const int first = block * blockSize;
+            const int count = particles - first < blockSize ? particles - first : blockSize;
+            for (int i = 0; i < count; i++)
+                fx[i] = fy[i] = 0.0;
 
-            distance = sqrt(dx * dx + dy * dy);
+            for (int j0 = 0; j0 < particles; j0 += tileSize)
+            {
+                const int n = particles - j0 < tileSize ? particles - j0 : tileSize;
+                for (int i0 = 0; i0 < count; i0 += DISTANCE_BLOCK)
+                {
+                    const int rows = count - i0 < DISTANCE_BLOCK ? count - i0 : DISTANCE_BLOCK;
+                    // a short group repeats its last particle; the extra rows are never used
+                    double xi[DISTANCE_BLOCK], yi[DISTANCE_BLOCK];
+                    for (int r = 0; r < DISTANCE_BLOCK; r++)
+                    {
+                        int idx = first + i0 + (r < rows ? r : rows - 1);
+                        xi[r] = x[idx];
+                        yi[r] = y[idx];
+                    }
+                    distanceBlockKernel(x + j0, y + j0, n, xi, yi, dxs.data(), dys.data(), distances.data(),
+                                        inverses.data());
+                    force->values(distances.data(), forces.data(), rows * n);
+                    for (int r = 0; r < rows; r++)
+                        accumulateChunk(&forces[r * n], &inverses[r * n], &dxs[r * n], &dys[r * n], n, 0.0,
+                                        fx[i0 + r], fy[i0 + r]);
+                }
+            }
 
-            frc = force->value(distance);
+            for (int i = 0; i < count; i++)
+            {
+                int idx = first + i;
+                double oldFx = Fx[idx];
+                double oldFy = Fy[idx];
+                Fx[idx] = fx[i];
+                Fy[idx] = fy[i];
+                Vx[idx] += dt_2 * (Fx[idx] + oldFx) / m[idx];
+                Vy[idx] += dt_2 * (Fy[idx] + oldFy) / m[idx];
+            }
+        }
+    }
+}
+
+// Kahan summation in float, lane k of the chunk into sums[k % LANES], so
+// that the lanes vectorize; sums holds x, y, then their compensations
+static constexpr int COMPENSATED_LANES = 16;
 
-            Fx[idx] += frc * dx / distance;
-            Fy[idx] += frc * dy / distance;
+static inline void accumulateCompensated(const float *forces, const float *inverses, const float *dxs,
+                                         const float *dys, int n, float shift, float *sums)
+{
+    float *sumX = sums, *sumY = sums + COMPENSATED_LANES;
+    float *lostX = sums + 2 * COMPENSATED_LANES, *lostY = sums + 3 * COMPENSATED_LANES;
+    for (int first = 0; first < n; first += COMPENSATED_LANES)
+    {
+        int lanes = n - first < COMPENSATED_LANES ? n - first : COMPENSATED_LANES;
+#pragma omp simd
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            int k = first + lane;
+            float frc = (forces[k] - shift) * inverses[k];
+            float termX = frc * dxs[k] - lostX[lane];
+            float termY = frc * dys[k] - lostY[lane];
+            float nextX = sumX[lane] + termX;
+            float nextY = sumY[lane] + termY;
+            lostX[lane] = (nextX - sumX[lane]) - termX;
+            lostY[lane] = (nextY - sumY[lane]) - termY;
+            sumX[lane] = nextX;
+            sumY[lane] = nextY;
+        }
+    }
+}
+
+// the batched loop on float copies of the positions; per-pair terms in
+// float, summed in double (MIXED) or in float with Kahan compensation
+// (SINGLE, the lanes added up in double at the end). Positions,
+// velocities and forces stay double.
+void Simulation::updateVelocitySingle()
+{
+    const bool useVerlet = prepareNeighbours();
+    const float cutoffSQ = cutoff > 0.0 ? (float)(cutoff * cutoff) : INFINITY;
+    const float shift = cutoff > 0.0 ? (float)force->value(cutoff) : 0.0f;
+    const bool mixed = precision == MIXED;
+    xSingle.resize(particles);
+    ySingle.resize(particles);
+
+#pragma omp parallel
+    {
+#pragma omp for
+        for (int idx = 0; idx < particles; idx++)
+        {
+            xSingle[idx] = (float)x[idx];
+            ySingle[idx] = (float)y[idx];
+        }
+
+        float dxs[PAIR_CHUNK], dys[PAIR_CHUNK], inverses[PAIR_CHUNK];
+        float distances[PAIR_CHUNK], forces[PAIR_CHUNK];
+
+#pragma omp for schedule(static)
+        for (int idx = 0; idx < particles; idx++)
+        {
+            const float xi = xSingle[idx], yi = ySingle[idx];
+            double fx = 0.0, fy = 0.0;
+            float sums[4 * COMPENSATED_LANES] = {};
+            partnerRanges(idx, useVerlet, [&](const int *begin, const int *end) {
+                for (; begin < end; begin += PAIR_CHUNK)
+                {
+                    int n = end - begin < PAIR_CHUNK ? end - begin : PAIR_CHUNK;
+                    distanceKernelSingle(xSingle.data(), ySingle.data(), begin, n, xi, yi, cutoffSQ,
+                                    dxs, dys, distances, inverses);
+                    force->valuesSingle(distances, forces, n);
+                    if (mixed)
+                        accumulateChunk(forces, inverses, dxs, dys, n, shift, fx, fy);
+                    else
+                        accumulateCompensated(forces, inverses, dxs, dys, n, shift, sums);
+                }
+            });
+
+            double oldFx = Fx[idx];
+            double oldFy = Fy[idx];
+            // the compensation holds what the float sum lost, with the
+            // opposite sign
+            if (!mixed)
+                for (int lane = 0; lane < COMPENSATED_LANES; lane++)
+                {
+                    fx += (double)sums[lane] - sums[2 * COMPENSATED_LANES + lane];
+                    fy += (double)sums[COMPENSATED_LANES + lane] - sums[3 * COMPENSATED_LANES + lane];
+                }
+            Fx[idx] = fx;
+            Fy[idx] = fy;
+            Vx[idx] += dt_2 * (Fx[idx] + oldFx) / m[idx];
+            Vy[idx] += dt_2 * (Fy[idx] + oldFy) / m[idx];
+        }
+    }
+}
+
+void Simulation::run(int steps, int callbackEvery, StepCallback callback, void *arg)
+{
+    const bool persistent = cutoff == 0.0 && !halfPairs && !batched && precision == DOUBLE && tileSize == 0
+                            && reorderEvery == 0;
+    const bool callbacks = callback && callbackEvery > 0;
+    int step = 0;
+    while (step < steps)
+    {
+        if (callbacks && step % callbackEvery == 0)
+            callback(step, this, arg);
+        int segment = callbacks ? callbackEvery - step % callbackEvery : steps;
+        segment = segment < steps - step ? segment : steps - step;
+        if (persistent)
+            runPersistent(segment);
+        else
+            for (int s = 0; s < segment; s++)
+                this->step();
+        step += segment;
+    }
+}
+
+// step() of the all-pairs mode with the team kept across the steps: forces
+// and velocities, a barrier, positions fused with preventMoveAgainstForce,
+// a barrier; the same arithmetic, particle for particle
+void Simulation::runPersistent(int steps)
+{
+#pragma omp parallel
+    {
+        const int threads = omp_get_num_threads();
+        const int thread = omp_get_thread_num();
+        const int first = (int)((long long)particles * thread / threads);
+        const int last = (int)((long long)particles * (thread + 1) / threads);
+
+        for (int s = 0; s < steps; s++)
+        {
+            for (int idx = first; idx < last; idx++)
+                updateVelocityOf(idx);
+#pragma omp barrier
+            for (int idx = first; idx < last; idx++)
+            {
+                x[idx] += dt * (Vx[idx] + dt_2 * Fx[idx] / m[idx]);
+                y[idx] += dt * (Vy[idx] + dt_2 * Fy[idx] / m[idx]);
+                if (molecularStatic && Vx[idx] * Fx[idx] + Vy[idx] * Fy[idx] < 0.0)
+                    Vx[idx] = Vy[idx] = {0.0};
+            }
+#pragma omp barrier
         }
-        Vx[idx] += dt_2 * (Fx[idx] + oldFx) / m[idx];
-        Vy[idx] += dt_2 * (Fy[idx] + oldFy) / m[idx];
     }
 }
 
@@ -138,40 +726,153 @@ double Simulation::Ekin()
     return ek;
 }
 
-void Simulation::pairDistribution(double *histogram, int size, double coef)
+// every thread counts into its own bins, a cache line at least away from
+// the next thread's, and the threads are added up in a fixed order
+void Simulation::clearThreadBins(int size)
+{
+    binStride = (size + 7) / 8 * 8 + 8;
+    threadBins.assign((size_t)omp_get_max_threads() * binStride, 0);
+}
+
+void Simulation::mergeThreadBins(long long *counts, int size)
 {
+    const int threads = (int)(threadBins.size() / binStride);
     for (int i = 0; i < size; i++)
-        histogram[i] = 0;
+    {
+        long long total = 0;
+        for (int t = 0; t < threads; t++)
+            total += threadBins[(size_t)t * binStride + i];
+        counts[i] = total;
+    }
+}
 
+void Simulation::pairDistributionCounts(long long *counts, int size, double coef)
+{
     const double maxDistanceSQ = size * coef * size * coef;
-    double dx, dy;
-    double distance;
-    int idx;
+    clearThreadBins(size);
 
-#pragma omp parallel for private(dx, dy, distance, idx) schedule(dynamic)
-    for (int idx1 = 0; idx1 < particles; idx1++)
+#pragma omp parallel
     {
-        for (int idx2 = 0; idx2 < idx1; idx2++)
+        long long *bins = threadBins.data() + (size_t)omp_get_thread_num() * binStride;
+
+#pragma omp for schedule(dynamic)
+        for (int idx1 = 0; idx1 < particles; idx1++)
         {
-            dx = x[idx2] - x[idx1];
-            dy = y[idx2] - y[idx1];
-            distance = dx * dx + dy * dy;
-            if (distance < maxDistanceSQ)
+            for (int idx2 = 0; idx2 < idx1; idx2++)
             {
-                distance = sqrt(distance);
-                idx = (int)(distance / coef);
-#pragma omp atomic
-                histogram[idx]++;
+                double dx = x[idx2] - x[idx1];
+                double dy = y[idx2] - y[idx1];
+                double distance = dx * dx + dy * dy;
+                if (distance < maxDistanceSQ)
+                    bins[(int)(sqrt(distance) / coef)]++;
             }
         }
     }
+    mergeThreadBins(counts, size);
+}
 
+void Simulation::pairDistribution(double *histogram, int size, double coef)
+{
+    std::vector<long long> counts(size);
+    pairDistributionCounts(counts.data(), size, coef);
+
+    double distance;
 #pragma omp parallel for private(distance)
     for (int i = 0; i < size; i++)
     {
         distance = (i + 0.5) * coef;
-        histogram[i] *= 1.0 / (2.0 * M_PI * distance * coef);
+        histogram[i] = counts[i] * (1.0 / (2.0 * M_PI * distance * coef));
+    }
+}
+
+// all pairs are walked once, idx2 < idx1, and update the minimum of both
+// particles in the thread's own array; the arrays are merged per particle
+// in thread order. A Verlet list holds both directions, so there every
+// particle walks its own list and the histogram takes idx2 < idx1 only.
+void Simulation::analysis(double *histogram, int size, double coef, double &ekin, double &avgMinDistance)
+{
+    const double maxDistanceSQ = size * coef * size * coef;
+    const bool useVerlet = cutoff > 0.0 && skin > 0.0 && size * coef <= cutoff;
+    if (useVerlet)
+        verlet.update(x, y, particles);
+    else
+        threadMinSQ.assign((size_t)omp_get_max_threads() * particles, 10000000.0);
+    const int threads = useVerlet ? 0 : (int)(threadMinSQ.size() / particles);
+    const double cutoffSQ = cutoff * cutoff;
+    double ek = 0.0, sum = 0.0;
+    clearThreadBins(size);
+
+#pragma omp parallel
+    {
+        long long *bins = threadBins.data() + (size_t)omp_get_thread_num() * binStride;
+
+        if (!useVerlet)
+        {
+            double *minSQ = threadMinSQ.data() + (size_t)omp_get_thread_num() * particles;
+#pragma omp for schedule(dynamic)
+            for (int idx1 = 0; idx1 < particles; idx1++)
+            {
+                const double xx = x[idx1], yy = y[idx1];
+                double dSqMin = minSQ[idx1];
+                for (int idx2 = 0; idx2 < idx1; idx2++)
+                {
+                    double dx = x[idx2] - xx;
+                    double dy = y[idx2] - yy;
+                    double distanceSQ = dx * dx + dy * dy;
+                    if (distanceSQ < dSqMin)
+                        dSqMin = distanceSQ;
+                    if (distanceSQ < minSQ[idx2])
+                        minSQ[idx2] = distanceSQ;
+                    if (distanceSQ < maxDistanceSQ)
+                        bins[(int)(sqrt(distanceSQ) / coef)]++;
+                }
+                minSQ[idx1] = dSqMin;
+            }
+        }
+
+#pragma omp for reduction(+ : ek, sum)
+        for (int idx1 = 0; idx1 < particles; idx1++)
+        {
+            ek += m[idx1] * (Vx[idx1] * Vx[idx1] + Vy[idx1] * Vy[idx1]) * 0.5;
+
+            double dSqMin = 10000000.0;
+            if (useVerlet)
+            {
+                const double xx = x[idx1], yy = y[idx1];
+                for (const int *p = verlet.begin(idx1); p != verlet.end(idx1); p++)
+                {
+                    double dx = x[*p] - xx;
+                    double dy = y[*p] - yy;
+                    double distanceSQ = dx * dx + dy * dy;
+                    if (distanceSQ < dSqMin)
+                        dSqMin = distanceSQ;
+                    if (*p < idx1 && distanceSQ < maxDistanceSQ)
+                        bins[(int)(sqrt(distanceSQ) / coef)]++;
+                }
+                // the lists hold every partner within the cutoff, not beyond
+                if (dSqMin >= cutoffSQ)
+                {
+                    double distance = minDistance(idx1);
+                    dSqMin = distance * distance;
+                }
+            }
+            else
+                for (int t = 0; t < threads; t++)
+                    if (threadMinSQ[(size_t)t * particles + idx1] < dSqMin)
+                        dSqMin = threadMinSQ[(size_t)t * particles + idx1];
+            sum += sqrt(dSqMin);
+        }
+    }
+
+    std::vector<long long> counts(size);
+    mergeThreadBins(counts.data(), size);
+    for (int i = 0; i < size; i++)
+    {
+        double distance = (i + 0.5) * coef;
+        histogram[i] = counts[i] * (1.0 / (2.0 * M_PI * distance * coef));
     }
+    ekin = ek;
+    avgMinDistance = sum / particles;
 }
 
 double Simulation::avgMinDistance()
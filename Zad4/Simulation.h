@@ -10,8 +10,21 @@
 
 #include"Force.h"
 #include"DataSupplier.h"
+#include"CellList.h"
+#include"VerletList.h"
+#include"PairKernels.h"
+#include"MortonOrder.h"
+
+#include<vector>
 
 class Simulation {
+public:
+	// arithmetic of the pair loop: double throughout, float pair terms
+	// summed in double, or float throughout with compensated sums
+	enum Precision { DOUBLE, MIXED, SINGLE };
+	// called by run between steps, outside of any parallel region
+	typedef void (*StepCallback)( int step, Simulation *simulation, void *arg );
+
 private:
 	double *x;
 	double *y;
@@ -26,20 +39,107 @@ private:
 	double dt_2;
 	bool molecularStatic;
 	Force *force;
+	double cutoff;
+	double skin;
+	CellList cells;
+	VerletList verlet;
+	bool halfPairs;
+	bool batched;
+	DistanceKernel distanceKernel;
+	DistanceKernelSingle distanceKernelSingle;
+	DistanceBlockKernel distanceBlockKernel;
+	Precision precision;
+	int tileSize;
+	MortonOrder morton;
+	int reorderEvery;
+	int reorderCountdown;
+	std::vector<int> ids; // original index of the particle in every slot
+	std::vector<double> reorderScratch;
+	std::vector<float> xSingle; // positions for the float pair loops
+	std::vector<float> ySingle;
+	std::vector<int> allIndices; // 0 .. particles - 1, all-pairs partners
+	std::vector<double> threadFx; // per-thread force buffers, particles each
+	std::vector<double> threadFy;
+	std::vector<long long> threadBins; // per-thread histograms, binStride apart
+	std::vector<double> threadMinSQ; // per-thread squared nearest-neighbour distances, particles each
+	int binStride;
 
 	void allocateMemory();
 
 	void updateVelocity();
+	void updateVelocityOf( int idx );
+	void updateVelocityCutoff();
+	void updateVelocityVerlet();
+	void updateVelocityHalf();
+	void updateVelocityBatched();
+	void updateVelocitySingle();
+	void updateVelocityTiled();
+	bool prepareNeighbours();
+	template <class Visit> void partnerRanges( int idx, bool useVerlet, Visit visit );
 	void updatePosition();
+	void runPersistent( int steps );
+	void permute( double *values, const int *order );
 	void preventMoveAgainstForce();
 	double minDistance( int idx );
+	void clearThreadBins( int size );
+	void mergeThreadBins( long long *counts, int size );
 
 public:
 	Simulation(Force *force, double dt, bool molecularStatic);
 
 	void step();
+	// steps times step(), with callback( step, this, arg ) before every
+	// step that is a multiple of callbackEvery (0: never). In the default
+	// all-pairs mode the steps between callbacks share one parallel region,
+	// each thread keeping its own range of particles; the other modes step
+	// one by one.
+	void run( int steps, int callbackEvery, StepCallback callback, void *arg );
+
+	// cutoff > 0: pairs further apart than cutoff do not interact and the
+	// force is shifted by -force->value(cutoff), so it goes to zero
+	// continuously there; partners come from a cell list rebuilt every step.
+	// 0 (the default): all pairs, unshifted.
+	void setCutoff( double cutoff );
+	// skin > 0 (with a cutoff): partners come from Verlet lists built with
+	// cutoff + skin, rebuilt only once a particle moved more than skin / 2
+	void setSkin( double skin );
+	// every pair is evaluated once and +F / -F go to both particles, through
+	// per-thread buffers summed in thread order: reproducible for a given
+	// number of threads; works with each of the modes above
+	void setHalfPairs( bool halfPairs );
+	// partners are gathered in chunks and their forces taken with one
+	// Force::values call per chunk; applies to the modes above except
+	// half pairs
+	void setBatched( bool batched );
+	// distance stage of the batched and tiled modes and of the float precisions, see
+	// PairKernels.h; false (and the kernels unchanged) if the name is
+	// unknown or the CPU cannot run it
+	bool setPairKernel( const char *name );
+	const char *pairKernelName();
+	// MIXED and SINGLE run the batched loop in float through
+	// Force::valuesSingle; half pairs take precedence
+	void setPrecision( Precision precision );
+	// tileSize > 0 (without a cutoff, in double): all pairs as blocks of
+	// particles against tiles of tileSize partners that stay in L1 for the
+	// whole block; for particle counts well beyond L2
+	void setTileSize( int tileSize );
+	// sorts all particle arrays along a Morton curve, so that neighbours in
+	// space are neighbours in memory; particleIds() keeps the original
+	// numbering. With every > 0 step() does it before every that many steps.
+	void reorder();
+	void setReorderEvery( int every );
+	const int *particleIds();
+	long long neighbourListBuilds();
+	double averageNeighbours();
 
 	void pairDistribution(double *histogram, int size, double coef);
+	// the pairs counted into each bin of pairDistribution, before the
+	// normalization; exact, whatever the number of threads
+	void pairDistributionCounts( long long *counts, int size, double coef );
+	// pairDistribution, Ekin and avgMinDistance from one sweep over the
+	// pairs; with Verlet lists covering the histogram range only the lists
+	// are walked
+	void analysis( double *histogram, int size, double coef, double &ekin, double &avgMinDistance );
 
 	double Ekin();
 	double avgMinDistance();
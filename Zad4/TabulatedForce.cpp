@@ -0,0 +1,62 @@
+/*
+ * TabulatedForce.cpp
+ */
+
+#include "TabulatedForce.h"
+
+#include <math.h>
+
+TabulatedForce::TabulatedForce(Force *exact, double range, int intervals)
+{
+    exact_ = exact;
+    range_ = range;
+    intervals_ = intervals;
+    step_ = range / intervals;
+    inverseStep_ = intervals / range;
+    nodes_.resize(2 * (intervals + 1));
+
+    const double d = 1e-5 * step_;
+    for (int i = 0; i <= intervals; i++)
+    {
+        double r = i * step_;
+        double slope;
+        if (i == 0) // one-sided, the force need not be defined below 0
+            slope = (-3.0 * exact->value(r) + 4.0 * exact->value(r + d) - exact->value(r + 2.0 * d)) / (2.0 * d);
+        else
+            slope = (exact->value(r + d) - exact->value(r - d)) / (2.0 * d);
+        nodes_[2 * i] = exact->value(r);
+        nodes_[2 * i + 1] = step_ * slope;
+    }
+
+    maxError_ = 0.0;
+    for (int i = 0; i < intervals; i++)
+    {
+        double r = (i + 0.5) * step_;
+        maxError_ = fmax(maxError_, fabs(interpolate(r) - exact->value(r)));
+    }
+}
+
+double TabulatedForce::interpolate(double distance) const
+{
+    double t = distance * inverseStep_;
+    int i = (int)t;
+    i = i < intervals_ ? i : intervals_ - 1;
+    double u = t - i;
+    const double *node = nodes_.data() + 2 * i;
+    double u2 = u * u, u3 = u2 * u;
+    return node[0] * (2.0 * u3 - 3.0 * u2 + 1.0) + node[1] * (u3 - 2.0 * u2 + u)
+         + node[2] * (3.0 * u2 - 2.0 * u3) + node[3] * (u3 - u2);
+}
+
+double TabulatedForce::value(double distance)
+{
+    if (distance > range_)
+        return exact_->value(distance);
+    return interpolate(distance);
+}
+
+void TabulatedForce::values(const double *distances, double *forces, int n)
+{
+    for (int i = 0; i < n; i++)
+        forces[i] = distances[i] > range_ ? exact_->value(distances[i]) : interpolate(distances[i]);
+}
@@ -0,0 +1,42 @@
+/*
+ * TabulatedForce.h
+ */
+
+#ifndef TABULATEDFORCE_H_
+#define TABULATEDFORCE_H_
+
+#include "Force.h"
+
+#include <vector>
+
+// Samples another Force once on a uniform grid over [0, range] and serves
+// values by cubic Hermite interpolation between the nodes, with slopes taken
+// by finite differences. For a smooth force the error stays below
+// h^4 / 384 * max|f''''| (h = range / intervals); maxError() is the largest
+// deviation actually seen at the interval midpoints. Beyond range the
+// wrapped force is asked directly. 1024 intervals take 16 KiB.
+class TabulatedForce : public Force
+{
+private:
+    Force *exact_;
+    double range_;
+    double step_;
+    double inverseStep_;
+    int intervals_;
+    std::vector<double> nodes_; // value and step * slope, interleaved
+    double maxError_;
+
+    double interpolate(double distance) const;
+
+public:
+    TabulatedForce(Force *exact, double range, int intervals);
+
+    double value(double distance);
+    void values(const double *distances, double *forces, int n);
+
+    double range() const { return range_; }
+    int intervals() const { return intervals_; }
+    double maxError() const { return maxError_; }
+};
+
+#endif /* TABULATEDFORCE_H_ */
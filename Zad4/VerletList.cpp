@@ -0,0 +1,101 @@
+/*
+ * VerletList.cpp
+ */
+
+#include "VerletList.h"
+
+VerletList::VerletList()
+{
+    cutoff_ = skin_ = 0.0;
+    valid_ = false;
+    builds_ = updates_ = 0;
+    lengthSum_ = 0.0;
+}
+
+void VerletList::setRange(double cutoff, double skin)
+{
+    cutoff_ = cutoff;
+    skin_ = skin;
+    valid_ = false;
+}
+
+void VerletList::invalidate()
+{
+    valid_ = false;
+}
+
+double VerletList::maxDisplacementSQ(const double *x, const double *y, int particles)
+{
+    double maxSQ = 0.0;
+#pragma omp parallel for reduction(max : maxSQ)
+    for (int idx = 0; idx < particles; idx++)
+    {
+        double dx = x[idx] - x0_[idx];
+        double dy = y[idx] - y0_[idx];
+        double dSQ = dx * dx + dy * dy;
+        maxSQ = dSQ > maxSQ ? dSQ : maxSQ;
+    }
+    return maxSQ;
+}
+
+bool VerletList::update(const double *x, const double *y, int particles)
+{
+    updates_++;
+    if (valid_ && (int)x0_.size() == particles && maxDisplacementSQ(x, y, particles) <= 0.25 * skin_ * skin_)
+        return false;
+    build(x, y, particles);
+    return true;
+}
+
+// two sweeps over the 3x3 bins: count, then fill at the prefix sums
+void VerletList::build(const double *x, const double *y, int particles)
+{
+    const double range = cutoff_ + skin_;
+    const double rangeSQ = range * range;
+    cells_.build(x, y, particles, range);
+    start_.assign(particles + 1, 0);
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1)
+        {
+            for (int idx = 0; idx < particles; idx++)
+                start_[idx + 1] += start_[idx];
+            neighbours_.resize(start_[particles]);
+        }
+#pragma omp parallel for schedule(dynamic, 256)
+        for (int idx = 0; idx < particles; idx++)
+        {
+            int cell = cells_.cellOf(idx);
+            int column = cell % cells_.columns();
+            int row = cell / cells_.columns();
+            int lastColumn = column + 1 < cells_.columns() ? column + 1 : column;
+            int lastRow = row + 1 < cells_.rows() ? row + 1 : row;
+            int found = 0;
+            int *out = pass ? neighbours_.data() + start_[idx] : 0;
+            for (int r = row > 0 ? row - 1 : 0; r <= lastRow; r++)
+                for (int c = column > 0 ? column - 1 : 0; c <= lastColumn; c++)
+                {
+                    int neighbour = cells_.cell(c, r);
+                    for (const int *p = cells_.begin(neighbour); p != cells_.end(neighbour); p++)
+                    {
+                        double dx = x[*p] - x[idx];
+                        double dy = y[*p] - y[idx];
+                        if (*p == idx || dx * dx + dy * dy >= rangeSQ)
+                            continue;
+                        if (pass)
+                            out[found] = *p;
+                        found++;
+                    }
+                }
+            if (!pass)
+                start_[idx + 1] = found;
+        }
+    }
+
+    x0_.assign(x, x + particles);
+    y0_.assign(y, y + particles);
+    valid_ = true;
+    builds_++;
+    lengthSum_ += particles ? (double)start_[particles] / particles : 0.0;
+}
@@ -0,0 +1,50 @@
+/*
+ * VerletList.h
+ */
+
+#ifndef VERLETLIST_H_
+#define VERLETLIST_H_
+
+#include "CellList.h"
+
+#include <vector>
+
+// Per-particle neighbour lists in CSR form: all partners within
+// cutoff + skin at the last build. They stay valid until some particle has
+// moved more than skin / 2 since then, so most steps reuse them unchanged.
+class VerletList
+{
+private:
+    double cutoff_;
+    double skin_;
+    bool valid_;
+    std::vector<int> start_;      // neighbours of i are neighbours_[start_[i] .. start_[i + 1])
+    std::vector<int> neighbours_;
+    std::vector<double> x0_, y0_; // positions at the last build
+    CellList cells_;
+    long long builds_;
+    long long updates_;
+    double lengthSum_;            // summed average list length over the builds
+
+    double maxDisplacementSQ(const double *x, const double *y, int particles);
+    void build(const double *x, const double *y, int particles);
+
+public:
+    VerletList();
+
+    void setRange(double cutoff, double skin);
+    // rebuilds if the lists are invalid or stale; true if it did
+    bool update(const double *x, const double *y, int particles);
+    // e.g. after the particles were renumbered
+    void invalidate();
+
+    const int *begin(int particle) const { return neighbours_.data() + start_[particle]; }
+    const int *end(int particle) const { return neighbours_.data() + start_[particle + 1]; }
+
+    long long builds() const { return builds_; }
+    long long updates() const { return updates_; }
+    // partners per particle, averaged over all builds
+    double averageLength() const { return builds_ ? lengthSum_ / builds_ : 0.0; }
+};
+
+#endif /* VERLETLIST_H_ */
@@ -1,3 +1,3 @@
 #!/bin/bash
 
-c++ -O2 -fopenmp DataSupplier.cpp Force.cpp main.cpp MyForce.cpp SimpleDataSupplier.cpp Simulation.cpp && ./a.out
+c++ -O2 -fopenmp CellList.cpp DataSupplier.cpp Force.cpp main.cpp MortonOrder.cpp MyForce.cpp PairKernels.cpp SimpleDataSupplier.cpp Simulation.cpp TabulatedForce.cpp VerletList.cpp && ./a.out
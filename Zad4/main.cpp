@@ -5,12 +5,16 @@
  *      Author: oramus
  */
 
+#include <math.h>
+
+#include <chrono>
 #include <iostream>
 
 #include "DataSupplier.h"
 #include "Force.h"
 #include "MyForce.h"
 #include "SimpleDataSupplier.h"
+#include "TabulatedForce.h"
 #include "Simulation.h"
 
 using namespace std;
@@ -27,36 +31,150 @@ constexpr double MASS = 1.0;
 constexpr int STEPS = 100000;
 constexpr int REPORT_PERIOD = 500;
 constexpr int PARTICLES_SQRT = 20;
+// > 0: interaction range with a cell list instead of all pairs;
+// MyForce is below 1e-12 beyond about 10
+constexpr double CUTOFF = 0.0;
+// > 0 (with CUTOFF): Verlet lists with this skin instead of the cell list
+constexpr double SKIN = 0.0;
+// each pair evaluated once, +F / -F applied to both particles
+constexpr bool HALF_PAIRS = false;
+// > 0: MyForce is interpolated from a table with this many intervals
+// over [0, FORCE_TABLE_RANGE] instead of calling exp and cos per pair
+constexpr int FORCE_TABLE_INTERVALS = 0;
+constexpr double FORCE_TABLE_RANGE = 12.0;
+// force magnitudes taken for chunks of partners through Force::values
+constexpr bool BATCHED = false;
+// distance stage of BATCHED and TILE_SIZE: "auto", "avx512", "avx2", "sse2" or "scalar"
+constexpr const char *PAIR_KERNEL = "auto";
+// DOUBLE, MIXED (float pair terms, double sums) or SINGLE (float with
+// compensated sums)
+constexpr Simulation::Precision PRECISION = Simulation::DOUBLE;
+// with PRECISION other than DOUBLE: a double run alongside, its deviation
+// in Ekin and in the histogram shown with every report
+constexpr bool VALIDATE_PRECISION = false;
+// > 0 (without CUTOFF): all pairs tiled, this many partners per tile;
+// 256 keeps a tile with its distance and force buffers within L1
+constexpr int TILE_SIZE = 0;
+// > 0: particles re-sorted along a Morton curve every this many steps,
+// for the neighbour modes (CUTOFF)
+constexpr int REORDER_EVERY = 0;
+// nominal flops per pair in updateVelocityOf: 2 for dx, dy, 3 for the
+// squared distance, sqrt, 7 for the force, 6 for the two components. exp and
+// cos count as one each; the double polynomials of MyForce take about 35 and
+// 40, so the machine executes closer to 90 per pair
+constexpr double NOMINAL_FLOPS_PER_PAIR = 19.0;
+
+struct Reports
+{
+    double *v;
+    Simulation *reference; // NULL unless the precision is validated
+    double *vReference;
+    double seconds;        // spent in report(), taken off the stepping time
+};
 
+Simulation *createSimulation(Force *force, DataSupplier *supplier, Simulation::Precision precision);
+void report(int step, Simulation *s, void *arg);
 void showReport(int i, Simulation *s, double *v);
+void showDeviation(Simulation *s, Simulation *reference, double *v, double *vReference);
 
 int main(int argc, char **argv)
 {
     double *v = new double[HISTOGRAM_SIZE];
 
     Force *force = new MyForce();
+    if (FORCE_TABLE_INTERVALS > 0)
+    {
+        TabulatedForce *table = new TabulatedForce(force, FORCE_TABLE_RANGE, FORCE_TABLE_INTERVALS);
+        cout << "Force table: " << table->intervals() << " intervals up to " << table->range()
+             << ", max error = " << table->maxError() << endl;
+        force = table;
+    }
 
     DataSupplier *supplier = new SimpleDataSupplier(PARTICLES_SQRT, DISTANCE, MASS);
     supplier->initializeData();
 
+    Simulation *simulation = createSimulation(force, supplier, PRECISION);
+    if (BATCHED || TILE_SIZE > 0)
+    {
+        if (!simulation->setPairKernel(PAIR_KERNEL))
+            cout << "Pair kernel " << PAIR_KERNEL << " not available here" << endl;
+        cout << "Pair kernel: " << simulation->pairKernelName() << endl;
+    }
+    Reports reports = {v, 0, 0, 0.0};
+    if (VALIDATE_PRECISION && PRECISION != Simulation::DOUBLE)
+    {
+        reports.reference = createSimulation(force, supplier, Simulation::DOUBLE);
+        reports.vReference = new double[HISTOGRAM_SIZE];
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    simulation->run(STEPS, REPORT_PERIOD, report, &reports);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    showReport(STEPS, simulation, v);
+    if (reports.reference)
+        showDeviation(simulation, reports.reference, v, reports.vReference);
+    if (TILE_SIZE > 0)
+    {
+        double stepping = seconds - reports.seconds;
+        double pairs = (double)STEPS * PARTICLES_SQRT * PARTICLES_SQRT * (PARTICLES_SQRT * PARTICLES_SQRT - 1);
+        cout << "Pair interactions per second (stepping only) = " << pairs / stepping << endl;
+        cout << "Nominal GFLOP/s (" << NOMINAL_FLOPS_PER_PAIR << " flops per pair) = "
+             << pairs * NOMINAL_FLOPS_PER_PAIR / stepping * 1e-9 << endl;
+    }
+    if (CUTOFF > 0.0 && SKIN > 0.0)
+        cout << "Neighbour list builds = " << simulation->neighbourListBuilds()
+             << " <neighbours> = " << simulation->averageNeighbours() << endl;
+}
+
+Simulation *createSimulation(Force *force, DataSupplier *supplier, Simulation::Precision precision)
+{
     Simulation *simulation = new Simulation(force, DT, true);
+    simulation->setCutoff(CUTOFF);
+    simulation->setSkin(SKIN);
+    simulation->setHalfPairs(HALF_PAIRS);
+    simulation->setBatched(BATCHED);
+    simulation->setPrecision(precision);
+    simulation->setTileSize(TILE_SIZE);
+    simulation->setReorderEvery(REORDER_EVERY);
     simulation->initialize(supplier);
+    return simulation;
+}
 
-    for (int step = 0; step < STEPS; step++)
+// the reference run, if any, catches up until the next report
+void report(int step, Simulation *s, void *arg)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Reports *reports = (Reports *)arg;
+    showReport(step, s, reports->v);
+    if (reports->reference)
     {
-        if (step % REPORT_PERIOD == 0)
-        {
-            showReport(step, simulation, v);
-        }
-        simulation->step();
+        showDeviation(s, reports->reference, reports->v, reports->vReference);
+        int steps = STEPS - step < REPORT_PERIOD ? STEPS - step : REPORT_PERIOD;
+        reports->reference->run(steps, 0, 0, 0);
     }
-    showReport(STEPS, simulation, v);
+    reports->seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// v holds the histogram of s from the report just shown
+void showDeviation(Simulation *s, Simulation *reference, double *v, double *vReference)
+{
+    double ekinReference, avgMinDistance;
+    reference->analysis(vReference, HISTOGRAM_SIZE, HISTOGRAM_LENGTH_PER_BIN, ekinReference, avgMinDistance);
+    double ekinDeviation = fabs(s->Ekin() - ekinReference);
+    double histogramDeviation = 0.0;
+    for (int j = 0; j < HISTOGRAM_SIZE; j++)
+        histogramDeviation = fmax(histogramDeviation, fabs(v[j] - vReference[j]));
+    cout << "Deviation from double: Ekin = " << ekinDeviation;
+    if (ekinReference > 0.0)
+        cout << " (" << ekinDeviation / ekinReference << " relative)";
+    cout << " max |v - v(double)| = " << histogramDeviation << endl;
 }
 
 void showReport(int step, Simulation *s, double *v)
 {
-    s->pairDistribution(v, HISTOGRAM_SIZE, HISTOGRAM_LENGTH_PER_BIN);
-    cout << "Step: " << step << " Ekin = " << s->Ekin() << " <min(NNdistance)> = " << s->avgMinDistance() << endl;
+    double ekin, avgMinDistance;
+    s->analysis(v, HISTOGRAM_SIZE, HISTOGRAM_LENGTH_PER_BIN, ekin, avgMinDistance);
+    cout << "Step: " << step << " Ekin = " << ekin << " <min(NNdistance)> = " << avgMinDistance << endl;
     for (int j = 0; j < HISTOGRAM_SIZE; j++)
     {
         cout << "v[" << j << "] = " << v[j] << endl;